@@ -0,0 +1,35 @@
+import java.util.concurrent.CancellationException;
+
+// Checked by long-running operations between units of work. A token is
+// cancelled once and stays cancelled; a child token is also cancelled
+// when its parent is.
+public class CancellationToken
+{
+	
+	public static final CancellationToken NONE = new CancellationToken();
+	
+	private final CancellationToken parent;
+	
+	private volatile boolean cancelled;
+	
+	public CancellationToken() {
+		this.parent = null;
+	}
+	
+	public CancellationToken(CancellationToken parent) {
+		this.parent = parent;
+	}
+	
+	public void cancel() {
+		if(this != NONE) this.cancelled = true;
+	}
+	
+	public boolean isCancelled() {
+		return this.cancelled || (this.parent != null && this.parent.isCancelled());
+	}
+	
+	public void throwIfCancelled() {
+		if(isCancelled()) throw new CancellationException("Operation cancelled");
+	}
+	
+}
\ No newline at end of file
@@ -1,18 +1,144 @@
-public class Global 
-{
-	
-	private static boolean status;
-	
-	public static void startProgram() {
-		status = true;
-	}
-	
-	public static boolean isRunning() {
-		return status;
-	}
-	
-	public static void endProgram() {
-		status = false;
-	}
-	
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.CopyOnWriteArrayList;
+
+public class Global 
+{
+	
+	public enum State { STARTING, RUNNING, DRAINING, STOPPED }
+	
+	// Shutdown phases, run in ascending order by endProgram(). Hooks in the
+	// same phase run in registration order.
+	public static final int PHASE_DRAIN = 100;
+	
+	public static final int PHASE_RELEASE = 200;
+	
+	private static final State[] STATES = State.values();
+	
+	// Padded on both sides so that hot isRunning() reads never share a
+	// cache line with unrelated writes.
+	static class LeftPad { long p1, p2, p3, p4, p5, p6, p7; }
+	
+	static class Value extends LeftPad { volatile int state; }
+	
+	static class PaddedState extends Value { long q1, q2, q3, q4, q5, q6, q7; }
+	
+	private static final PaddedState status = new PaddedState();
+	
+	private static final VarHandle STATE;
+	
+	static {
+		try {
+			STATE = MethodHandles.lookup().findVarHandle(Value.class, "state", int.class);
+		} catch(ReflectiveOperationException e) {
+			throw new ExceptionInInitializerError(e);
+		}
+	}
+	
+	private static volatile CancellationToken token = new CancellationToken();
+	
+	private static final List<Hook> endHooks = new CopyOnWriteArrayList<Hook>();
+	
+	// The thread running endProgram(), while the state is DRAINING.
+	private static volatile Thread drainer;
+	
+	// Waits out a drain in progress on another thread. An end hook cannot
+	// start the next run, since the drain it is part of would never end.
+	public static void startProgram() {
+		while(true) {
+			int s = (int)STATE.getAcquire(status);
+			if(s == State.RUNNING.ordinal()) return;
+			if(s == State.DRAINING.ordinal()) {
+				if(drainer == Thread.currentThread())
+					throw new IllegalStateException("startProgram() called from an end hook");
+				Thread.onSpinWait();
+				continue;
+			}
+			if(STATE.compareAndSet(status, s, State.RUNNING.ordinal())) {
+				Scheduler.start();
+				return;
+			}
+		}
+	}
+	
+	public static boolean isRunning() {
+		return (int)STATE.getAcquire(status) == State.RUNNING.ordinal();
+	}
+	
+	public static State state() {
+		return STATES[(int)STATE.getAcquire(status)];
+	}
+	
+	// The token of the current run. It is cancelled as soon as
+	// endProgram() starts draining and replaced before the state becomes
+	// STOPPED, so work started after the run ended is not cut short.
+	public static CancellationToken token() {
+		return token;
+	}
+	
+	// Hooks run when the program ends, e.g. to drain write-behind queues
+	// before the process exits.
+	public static void onEnd(Runnable hook) {
+		onEnd(PHASE_DRAIN, hook);
+	}
+	
+	public static void onEnd(int phase, Runnable hook) {
+		endHooks.add(new Hook(phase, hook));
+	}
+	
+	public static void removeOnEnd(Runnable hook) {
+		for(Hook h : endHooks)
+			if(h.hook == hook) endHooks.remove(h);
+	}
+	
+	public static void endProgram() {
+		while(true) {
+			int s = (int)STATE.getAcquire(status);
+			if(s == State.DRAINING.ordinal() || s == State.STOPPED.ordinal()) return;
+			if(STATE.compareAndSet(status, s, State.DRAINING.ordinal())) break;
+		}
+		drainer = Thread.currentThread();
+		token.cancel();
+		List<Hook> hooks = new ArrayList<Hook>(endHooks);
+		Collections.sort(hooks, (a, b) -> Integer.compare(a.phase, b.phase));
+		// Drain hooks may still hand work to the scheduler, and release hooks
+		// free what its tasks use, so its queue empties in between.
+		boolean drained = false;
+		for(Hook h : hooks) {
+			if(!drained && h.phase >= PHASE_RELEASE) {
+				Scheduler.drain();
+				drained = true;
+			}
+			try {
+				h.hook.run();
+			} catch(RuntimeException re) {
+				re.printStackTrace();
+			}
+		}
+		if(!drained) Scheduler.drain();
+		Trace.dump();
+		// Swapped in before the state flips, so a STOPPED or later RUNNING
+		// reader never sees the cancelled token of the run that ended.
+		token = new CancellationToken();
+		drainer = null;
+		STATE.setRelease(status, State.STOPPED.ordinal());
+	}
+	
+	private static class Hook
+	{
+		
+		final int phase;
+		
+		final Runnable hook;
+		
+		Hook(int phase, Runnable hook) {
+			this.phase = phase;
+			this.hook = hook;
+		}
+		
+	}
+	
 }
\ No newline at end of file
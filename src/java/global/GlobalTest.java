@@ -1,57 +1,190 @@
-import java.util.Vector;
-
-public class GlobalTest
-{
-	
-	private static int EXIT_STATUS;
-	
-	private static Vector<String> endStatus;
-	
-	public static void main(String args[]) {
-		System.out.println();
-		System.out.println("Testing Global Functions ... ");
-		System.out.println();
-		endStatus = new Vector<String>(1,1);
-		emptyTest();
-		runTest();
-		endTest();
-		displayVector(endStatus);
-		System.exit(EXIT_STATUS);
-	}
-	
-	public static void displayVector(Vector<String> v) {
-		for(int i = 0; i < v.size(); i++)
-			System.out.println(v.elementAt(i));
-	}
-
-	public static void emptyTest() {
-		if(Global.isRunning() == true) {
-			endStatus.addElement("Global Init Test : FAIL");
-			EXIT_STATUS = 1;
-		} else {
-			endStatus.addElement("Global Init Test : PASS");
-		}
-	}
-	
-	public static void runTest() {
-		Global.startProgram();
-		if(Global.isRunning() == false) {
-			endStatus.addElement("Global Run Test : FAIL");
-			EXIT_STATUS = 1;
-		} else {
-			endStatus.addElement("Global Run Test : PASS");
-		}
-	}
-	
-	public static void endTest() {
-		Global.startProgram();
-		Global.endProgram();
-		if(Global.isRunning() == true) {
-			endStatus.addElement("Global End Run Test : FAIL");
-			EXIT_STATUS = 1;
-		} else {
-			endStatus.addElement("Global End Run Test : PASS");
-		}
-	}
-	
+import java.io.File;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.util.Vector;
+import java.util.concurrent.ForkJoinTask;
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class GlobalTest
+{
+	
+	private static int EXIT_STATUS;
+	
+	private static Vector<String> endStatus;
+	
+	public static void main(String args[]) {
+		System.out.println();
+		System.out.println("Testing Global Functions ... ");
+		System.out.println();
+		endStatus = new Vector<String>(1,1);
+		emptyTest();
+		runTest();
+		endTest();
+		hookTest();
+		restartFromHookTest();
+		stateTest();
+		phaseTest();
+		schedulerTest();
+		metricsTest();
+		traceTest();
+		displayVector(endStatus);
+		System.exit(EXIT_STATUS);
+	}
+	
+	public static void displayVector(Vector<String> v) {
+		for(int i = 0; i < v.size(); i++)
+			System.out.println(v.elementAt(i));
+	}
+	
+	private static void report(boolean ok, String name) {
+		endStatus.addElement(name + (ok ? " : PASS" : " : FAIL"));
+		if(!ok) EXIT_STATUS = 1;
+	}
+
+	public static void emptyTest() {
+		report(!Global.isRunning(), "Global Init Test");
+	}
+	
+	public static void runTest() {
+		Global.startProgram();
+		report(Global.isRunning(), "Global Run Test");
+	}
+	
+	public static void endTest() {
+		Global.startProgram();
+		Global.endProgram();
+		report(!Global.isRunning(), "Global End Run Test");
+	}
+	
+	public static void hookTest() {
+		final int[] runs = new int[1];
+		Runnable hook = new Runnable() {
+			public void run() {
+				runs[0]++;
+			}
+		};
+		Global.startProgram();
+		Global.onEnd(hook);
+		Global.endProgram();
+		Global.removeOnEnd(hook);
+		Global.startProgram();
+		Global.endProgram();
+		report(runs[0] == 1, "Global End Hook Test");
+	}
+	
+	public static void restartFromHookTest() {
+		final boolean[] refused = new boolean[1];
+		Runnable hook = () -> {
+			try {
+				Global.startProgram();
+			} catch(IllegalStateException ise) {
+				refused[0] = true;
+			}
+		};
+		Global.startProgram();
+		Global.onEnd(hook);
+		Global.endProgram();
+		Global.removeOnEnd(hook);
+		report(refused[0] && Global.state() == Global.State.STOPPED, "Global Restart From Hook Test");
+	}
+	
+	public static void stateTest() {
+		Global.startProgram();
+		CancellationToken run = Global.token();
+		CancellationToken child = new CancellationToken(run);
+		final Global.State[] during = new Global.State[1];
+		Runnable hook = () -> during[0] = Global.state();
+		Global.onEnd(hook);
+		boolean running = (Global.state() == Global.State.RUNNING) && !child.isCancelled();
+		Global.endProgram();
+		Global.removeOnEnd(hook);
+		boolean stopped = (Global.state() == Global.State.STOPPED) && run.isCancelled() && child.isCancelled()
+			&& (during[0] == Global.State.DRAINING) && !Global.token().isCancelled();
+		Global.startProgram();
+		boolean fresh = !Global.token().isCancelled();
+		Global.endProgram();
+		report(running && stopped && fresh, "Global State Machine Test");
+	}
+	
+	public static void phaseTest() {
+		final StringBuilder order = new StringBuilder();
+		Runnable release = () -> order.append('R');
+		Runnable drain = () -> order.append('D');
+		Global.startProgram();
+		Global.onEnd(Global.PHASE_RELEASE, release);
+		Global.onEnd(Global.PHASE_DRAIN, drain);
+		Global.endProgram();
+		Global.removeOnEnd(release);
+		Global.removeOnEnd(drain);
+		report(order.toString().equals("DR"), "Global Shutdown Phase Test");
+	}
+	
+	public static void schedulerTest() {
+		final AtomicInteger done = new AtomicInteger();
+		final int[] atRelease = new int[1];
+		Runnable release = () -> atRelease[0] = done.get();
+		Global.startProgram();
+		Global.onEnd(Global.PHASE_RELEASE, release);
+		ForkJoinTask<Integer> sum = Scheduler.submit(() -> 21 + 21);
+		for(int i = 0; i < 100; i++) {
+			Scheduler.execute(() -> {
+				try {
+					Thread.sleep(1);
+				} catch(InterruptedException ie) {
+					return;
+				}
+				done.incrementAndGet();
+			});
+		}
+		boolean result = sum.join() == 42 && Scheduler.supply(() -> "OK").join().equals("OK");
+		Global.endProgram();
+		Global.removeOnEnd(release);
+		report(result && done.get() == 100 && atRelease[0] == 100, "Global Scheduler Test");
+	}
+	
+	public static void metricsTest() {
+		Metrics.Counter c = Metrics.counter("test.counter");
+		Metrics.Histogram h = Metrics.histogram("test.latency");
+		for(int i = 1; i <= 1000; i++) {
+			c.increment();
+			h.record(i * 1000L);
+		}
+		Metrics.Histogram.Snapshot s = h.snapshot();
+		long p50 = s.percentile(0.5);
+		boolean bucketed = true;
+		for(long v = 1; v > 0 && v < Long.MAX_VALUE / 3; v = v * 3 + 1) {
+			int b = Metrics.Histogram.bucket(v);
+			bucketed = bucketed && Metrics.Histogram.lowest(b) <= v && v < Metrics.Histogram.lowest(b + 1);
+		}
+		boolean result = !Metrics.ENABLED
+			|| (c.sum() == 1000 && s.count() == 1000 && s.max() == 1000000
+				&& Math.abs(p50 - 500000) <= 500000 / 16 && s.percentile(1.0) == 1000000
+				&& Metrics.snapshot().get("test.latency.count") == 1000 && bucketed);
+		report(result, "Global Metrics Test");
+	}
+	
+	public static void traceTest() {
+		File out = new File("trace.test");
+		Trace.enable(out, 2);
+		Global.startProgram();
+		for(int i = 0; i < 6; i++) {
+			long t = Trace.start();
+			Trace.end(t, "vectorRead", "dir\\a \"quoted\".txt", i);
+		}
+		Global.endProgram();
+		Trace.disable();
+		boolean result = false;
+		try {
+			String json = new String(Files.readAllBytes(out.toPath()), StandardCharsets.UTF_8);
+			int events = json.split("\"ph\":\"X\"", -1).length - 1;
+			result = json.startsWith("{\"displayTimeUnit\"") && events == 3 && json.contains("\"thread_name\"")
+				&& json.contains("\"path\":\"dir\\\\a \\\"quoted\\\".txt\"");
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		out.delete();
+		report(result, "Global Trace Dump Test");
+	}
+	
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.LongAccumulator;
+import java.util.concurrent.atomic.LongAdder;
+
+// Process-wide counters and latency histograms. Recording never takes a
+// lock: counters are LongAdders and histograms keep one bucket array per
+// stripe, picked by thread, so concurrent readers do not fight over a
+// cache line. -Dphoton.metrics=false turns recording into a no-op.
+public class Metrics
+{
+	
+	public static final boolean ENABLED = !"false".equals(System.getProperty("photon.metrics"));
+	
+	private static final ConcurrentHashMap<String, Counter> counters = new ConcurrentHashMap<String, Counter>();
+	
+	private static final ConcurrentHashMap<String, Histogram> histograms = new ConcurrentHashMap<String, Histogram>();
+	
+	public static Counter counter(String name) {
+		return counters.computeIfAbsent(name, n -> new Counter());
+	}
+	
+	public static Histogram histogram(String name) {
+		return histograms.computeIfAbsent(name, n -> new Histogram());
+	}
+	
+	// Every metric as a flat name/value map, sorted by name. Histograms
+	// contribute .count, .sum, .max, .p50, .p90, .p99 and .p999 entries.
+	public static Map<String, Long> snapshot() {
+		TreeMap<String, Long> m = new TreeMap<String, Long>();
+		for(Map.Entry<String, Counter> e : counters.entrySet())
+			m.put(e.getKey(), e.getValue().sum());
+		for(Map.Entry<String, Histogram> e : histograms.entrySet()) {
+			Histogram.Snapshot s = e.getValue().snapshot();
+			String n = e.getKey();
+			m.put(n + ".count", s.count());
+			m.put(n + ".sum", s.sum());
+			m.put(n + ".max", s.max());
+			m.put(n + ".p50", s.percentile(0.50));
+			m.put(n + ".p90", s.percentile(0.90));
+			m.put(n + ".p99", s.percentile(0.99));
+			m.put(n + ".p999", s.percentile(0.999));
+		}
+		return m;
+	}
+	
+	// The snapshot as "name value" lines, for scraping.
+	public static String scrape() {
+		StringBuilder sb = new StringBuilder();
+		for(Map.Entry<String, Long> e : snapshot().entrySet())
+			sb.append(e.getKey()).append(' ').append(e.getValue()).append('\n');
+		return sb.toString();
+	}
+	
+	public static void reset() {
+		for(Counter c : counters.values())
+			c.adder.reset();
+		for(Histogram h : histograms.values())
+			h.reset();
+	}
+	
+	public static final class Counter
+	{
+		
+		private final LongAdder adder = new LongAdder();
+		
+		private Counter() {
+		}
+		
+		public void add(long n) {
+			if(ENABLED) this.adder.add(n);
+		}
+		
+		public void increment() {
+			if(ENABLED) this.adder.increment();
+		}
+		
+		public long sum() {
+			return this.adder.sum();
+		}
+		
+	}
+	
+	// Log-linear buckets in the style of HdrHistogram: values below 16
+	// get a bucket each, and every power of two above that is split into
+	// 16 buckets, so any recorded value is reported within 6.25%.
+	public static final class Histogram
+	{
+		
+		private static final int SUB_BITS = 4;
+		
+		private static final int SUB = 1 << SUB_BITS;
+		
+		static final int BUCKETS = (64 - SUB_BITS) * SUB;
+		
+		private static final int STRIPES = stripes();
+		
+		private final AtomicLongArray[] counts = new AtomicLongArray[STRIPES];
+		
+		private final LongAdder sum = new LongAdder();
+		
+		private final LongAccumulator max = new LongAccumulator(Math::max, 0);
+		
+		private Histogram() {
+			for(int i = 0; i < STRIPES; i++)
+				this.counts[i] = new AtomicLongArray(BUCKETS);
+		}
+		
+		private static int stripes() {
+			int n = Math.min(Runtime.getRuntime().availableProcessors(), 8);
+			return Integer.highestOneBit(Math.max(n, 1));
+		}
+		
+		static int bucket(long v) {
+			if(v < SUB) return (int)Math.max(v, 0);
+			int e = 63 - Long.numberOfLeadingZeros(v);
+			return (e - SUB_BITS + 1) * SUB + (int)((v >>> (e - SUB_BITS)) & (SUB - 1));
+		}
+		
+		// Smallest value that lands in bucket i.
+		static long lowest(int i) {
+			if(i < SUB) return i;
+			int e = i / SUB + SUB_BITS - 1;
+			return (long)(SUB + i % SUB) << (e - SUB_BITS);
+		}
+		
+		public void record(long value) {
+			if(!ENABLED) return;
+			int stripe = (int)Thread.currentThread().getId() & (STRIPES - 1);
+			this.counts[stripe].getAndIncrement(bucket(value));
+			this.sum.add(value);
+			this.max.accumulate(value);
+		}
+		
+		// Records the time since start, a System.nanoTime() reading.
+		public void recordSince(long start) {
+			if(ENABLED) record(System.nanoTime() - start);
+		}
+		
+		public Snapshot snapshot() {
+			long[] c = new long[BUCKETS];
+			for(int s = 0; s < STRIPES; s++)
+				for(int i = 0; i < BUCKETS; i++)
+					c[i] += this.counts[s].get(i);
+			return new Snapshot(c, this.sum.sum(), this.max.get());
+		}
+		
+		void reset() {
+			for(int s = 0; s < STRIPES; s++)
+				for(int i = 0; i < BUCKETS; i++)
+					this.counts[s].set(i, 0);
+			this.sum.reset();
+			this.max.reset();
+		}
+		
+		public static final class Snapshot
+		{
+			
+			private final long[] counts;
+			
+			private final long count;
+			
+			private final long sum;
+			
+			private final long max;
+			
+			Snapshot(long[] counts, long sum, long max) {
+				this.counts = counts;
+				long n = 0;
+				for(int i = 0; i < counts.length; i++)
+					n += counts[i];
+				this.count = n;
+				this.sum = sum;
+				this.max = max;
+			}
+			
+			public long count() {
+				return this.count;
+			}
+			
+			public long sum() {
+				return this.sum;
+			}
+			
+			public long max() {
+				return this.max;
+			}
+			
+			// The highest value in the bucket holding the q-th quantile, capped
+			// at the largest value recorded.
+			public long percentile(double q) {
+				if(this.count == 0) return 0;
+				long rank = (long)Math.ceil(q * this.count);
+				long seen = 0;
+				for(int i = 0; i < this.counts.length; i++) {
+					seen += this.counts[i];
+					if(seen >= rank && this.counts[i] > 0) {
+						long high = (i + 1 < BUCKETS) ? lowest(i + 1) - 1 : Long.MAX_VALUE;
+						return Math.min(high, this.max);
+					}
+				}
+				return this.max;
+			}
+			
+		}
+		
+	}
+	
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+import java.util.concurrent.Callable;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.ForkJoinTask;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.TimeUnit;
+import java.util.function.Supplier;
+
+// The runtime's shared task pool. ForkJoinPool keeps a deque per worker
+// and lets idle workers steal from busy ones, so every parallel read and
+// write-behind queue in the process runs on one set of threads sized to
+// the machine. Global.startProgram() starts it and endProgram() waits for
+// the tasks already submitted before anything is released.
+public class Scheduler
+{
+	
+	// -Dphoton.parallelism overrides the worker count.
+	public static final int PARALLELISM = Integer.getInteger("photon.parallelism",
+		Runtime.getRuntime().availableProcessors());
+	
+	private static final long DRAIN_SECONDS = 30;
+	
+	private static ForkJoinPool pool;
+	
+	// The current pool. Work submitted outside a program, or after a
+	// drain, gets a fresh pool that the next endProgram() drains.
+	public static synchronized ForkJoinPool pool() {
+		if(pool == null || pool.isShutdown())
+			pool = new ForkJoinPool(Math.max(PARALLELISM, 1), ForkJoinPool.defaultForkJoinWorkerThreadFactory, null, true);
+		return pool;
+	}
+	
+	public static int parallelism() {
+		return pool().getParallelism();
+	}
+	
+	public static void execute(Runnable task) {
+		while(true) {
+			try {
+				pool().execute(task);
+				return;
+			} catch(RejectedExecutionException ree) {
+				// Raced with drain(); the next pool() call replaces it.
+			}
+		}
+	}
+	
+	public static <T> ForkJoinTask<T> submit(Callable<T> task) {
+		while(true) {
+			try {
+				return pool().submit(task);
+			} catch(RejectedExecutionException ree) {
+			}
+		}
+	}
+	
+	public static <T> CompletableFuture<T> supply(Supplier<T> task) {
+		return CompletableFuture.supplyAsync(task, Scheduler::execute);
+	}
+	
+	static void start() {
+		pool();
+	}
+	
+	// Stops taking work and waits for what is queued or running. Tasks
+	// still going after DRAIN_SECONDS are interrupted.
+	static void drain() {
+		ForkJoinPool p;
+		synchronized(Scheduler.class) {
+			p = pool;
+			pool = null;
+		}
+		if(p == null) return;
+		p.shutdown();
+		try {
+			if(!p.awaitTermination(DRAIN_SECONDS, TimeUnit.SECONDS))
+				p.shutdownNow();
+		} catch(InterruptedException ie) {
+			p.shutdownNow();
+			Thread.currentThread().interrupt();
+		}
+	}
+	
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+import java.io.BufferedWriter;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStreamWriter;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.CopyOnWriteArrayList;
+
+// Opt-in sampled tracing of I/O calls. Each thread records into its own
+// fixed-size ring, keeping the most recent events, and endProgram() dumps
+// everything as Chrome trace JSON that chrome://tracing and Perfetto can
+// open. Enabled with -Dphoton.trace=<file>; -Dphoton.trace.sample=N keeps
+// one call in N. Disabled, a call site costs one volatile read.
+public class Trace
+{
+	
+	public static final int DEFAULT_CAPACITY = 4096;
+	
+	private static volatile boolean enabled;
+	
+	private static volatile File output;
+	
+	private static volatile int sample = 1;
+	
+	private static final long BASE = System.nanoTime();
+	
+	private static final List<Ring> rings = new CopyOnWriteArrayList<Ring>();
+	
+	private static final ThreadLocal<Ring> local = ThreadLocal.withInitial(() -> {
+		Ring r = new Ring(Thread.currentThread(), Integer.getInteger("photon.trace.buffer", DEFAULT_CAPACITY));
+		rings.add(r);
+		return r;
+	});
+	
+	static {
+		String path = System.getProperty("photon.trace");
+		if(path != null && !path.isEmpty())
+			enable(new File(path), Integer.getInteger("photon.trace.sample", 1));
+	}
+	
+	public static void enable(File out, int sampleEvery) {
+		output = out;
+		sample = Math.max(sampleEvery, 1);
+		enabled = true;
+	}
+	
+	public static void disable() {
+		enabled = false;
+	}
+	
+	public static boolean isEnabled() {
+		return enabled;
+	}
+	
+	// A start time for end(), or 0 when this call is not sampled.
+	public static long start() {
+		if(!enabled) return 0;
+		Ring r = local.get();
+		if(++r.calls % sample != 0) return 0;
+		long t = System.nanoTime();
+		return (t == 0) ? 1 : t;
+	}
+	
+	public static void end(long start, String name, String path, long bytes) {
+		if(start == 0) return;
+		long now = System.nanoTime();
+		local.get().add(start - BASE, now - start, name, path, bytes);
+	}
+	
+	// Writes every buffered event to the configured file and clears the
+	// rings. Called by Global.endProgram().
+	static void dump() {
+		File out = output;
+		if(out == null) return;
+		boolean any = false;
+		for(Ring r : rings)
+			any = any || r.size() > 0;
+		if(!any) return;
+		try {
+			BufferedWriter w = new BufferedWriter(new OutputStreamWriter(new FileOutputStream(out), StandardCharsets.UTF_8));
+			try {
+				write(w);
+			} finally {
+				w.close();
+			}
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+	}
+	
+	private static void write(BufferedWriter w) throws IOException {
+		w.write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+		boolean first = true;
+		ArrayList<Ring> dead = new ArrayList<Ring>();
+		for(Ring r : rings) {
+			List<String> events = r.drain();
+			if(events.isEmpty() && !r.thread.isAlive()) dead.add(r);
+			if(events.isEmpty()) continue;
+			w.write(first ? "\n" : ",\n");
+			first = false;
+			w.write("{\"ph\":\"M\",\"pid\":1,\"tid\":" + r.tid + ",\"name\":\"thread_name\",\"args\":{\"name\":" + quote(r.name) + "}}");
+			for(String e : events) {
+				w.write(",\n");
+				w.write(e);
+			}
+		}
+		w.write("\n]}\n");
+		rings.removeAll(dead);
+	}
+	
+	static String quote(String s) {
+		StringBuilder sb = new StringBuilder(s.length() + 2);
+		sb.append('"');
+		for(int i = 0; i < s.length(); i++) {
+			char c = s.charAt(i);
+			if(c == '"' || c == '\\') {
+				sb.append('\\').append(c);
+			} else if(c < 0x20) {
+				sb.append(String.format("\\u%04x", (int)c));
+			} else {
+				sb.append(c);
+			}
+		}
+		return sb.append('"').toString();
+	}
+	
+	// Events as parallel arrays, overwritten oldest first once full. Only
+	// its own thread records into a ring; the lock is for dump().
+	private static class Ring
+	{
+		
+		final Thread thread;
+		
+		final long tid;
+		
+		final String name;
+		
+		long calls;
+		
+		private final long[] ts;
+		
+		private final long[] dur;
+		
+		private final long[] bytes;
+		
+		private final String[] names;
+		
+		private final String[] paths;
+		
+		private long next;
+		
+		Ring(Thread t, int capacity) {
+			this.thread = t;
+			this.tid = t.getId();
+			this.name = t.getName();
+			capacity = Math.max(capacity, 1);
+			this.ts = new long[capacity];
+			this.dur = new long[capacity];
+			this.bytes = new long[capacity];
+			this.names = new String[capacity];
+			this.paths = new String[capacity];
+		}
+		
+		synchronized void add(long ts, long dur, String name, String path, long bytes) {
+			int i = (int)(this.next++ % this.ts.length);
+			this.ts[i] = ts;
+			this.dur[i] = dur;
+			this.names[i] = name;
+			this.paths[i] = path;
+			this.bytes[i] = bytes;
+		}
+		
+		synchronized int size() {
+			return (int)Math.min(this.next, this.ts.length);
+		}
+		
+		// Chrome "complete" events, oldest first; timestamps are in
+		// microseconds.
+		synchronized List<String> drain() {
+			int n = size();
+			ArrayList<String> out = new ArrayList<String>(n);
+			for(long k = this.next - n; k < this.next; k++) {
+				int i = (int)(k % this.ts.length);
+				out.add("{\"ph\":\"X\",\"cat\":\"io\",\"pid\":1,\"tid\":" + this.tid
+					+ ",\"name\":" + quote(this.names[i])
+					+ ",\"ts\":" + micros(this.ts[i]) + ",\"dur\":" + micros(this.dur[i])
+					+ ",\"args\":{\"path\":" + quote(String.valueOf(this.paths[i])) + ",\"bytes\":" + this.bytes[i] + "}}");
+				this.names[i] = null;
+				this.paths[i] = null;
+			}
+			this.next = 0;
+			return out;
+		}
+		
+		private static String micros(long ns) {
+			return (ns / 1000) + "." + String.format("%03d", ns % 1000);
+		}
+		
+	}
+	
+}
\ No newline at end of file
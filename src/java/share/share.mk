@@ -1,4 +1,8 @@
-include ../../share/share.mk
-
-BUILD_DIR = ../../../build/
-BUILD_TEST_DIR = $(BUILD_DIR)/test/
\ No newline at end of file
+include ../../share/share.mk
+
+BUILD_DIR = ../../../build/
+BUILD_TEST_DIR = $(BUILD_DIR)/test/
+BUILD_BENCH_DIR = $(BUILD_DIR)/bench/
+
+# Sources in util and global may refer to classes in global
+JAVAC = javac -sourcepath .:../global
\ No newline at end of file
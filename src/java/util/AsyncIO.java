@@ -0,0 +1,161 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.AsynchronousFileChannel;
+import java.nio.channels.CompletionHandler;
+import java.nio.charset.Charset;
+import java.nio.file.StandardOpenOption;
+import java.util.List;
+import java.util.concurrent.CompletableFuture;
+
+// Whole-file reads and writes over AsynchronousFileChannel. Each call
+// chains positioned operations through completion handlers, so no thread
+// of the caller's waits on the disk.
+public class AsyncIO
+{
+
+	public static CompletableFuture<ByteBuffer> readAll(File f) {
+		CompletableFuture<ByteBuffer> cf = new CompletableFuture<ByteBuffer>();
+		try {
+			AsynchronousFileChannel ch = AsynchronousFileChannel.open(f.toPath(), StandardOpenOption.READ);
+			long size = ch.size();
+			if(size > Integer.MAX_VALUE - 8) {
+				close(ch);
+				cf.completeExceptionally(new IOException("File too large for an async read: " + f));
+				return cf;
+			}
+			readFrom(ch, ByteBuffer.allocate((int)size), cf);
+		} catch(IOException ioe) {
+			cf.completeExceptionally(ioe);
+		}
+		return cf;
+	}
+
+	private static void readFrom(final AsynchronousFileChannel ch, final ByteBuffer buf, final CompletableFuture<ByteBuffer> cf) {
+		ch.read(buf, buf.position(), null, new CompletionHandler<Integer, Void>() {
+			public void completed(Integer n, Void a) {
+				if(n < 0 || !buf.hasRemaining()) {
+					close(ch);
+					buf.flip();
+					cf.complete(buf);
+				} else {
+					readFrom(ch, buf, cf);
+				}
+			}
+			public void failed(Throwable t, Void a) {
+				close(ch);
+				cf.completeExceptionally(t);
+			}
+		});
+	}
+
+	// Reads just far enough to find the first line terminator.
+	public static CompletableFuture<String> readFirstLine(File f, Charset cs) {
+		CompletableFuture<String> cf = new CompletableFuture<String>();
+		try {
+			FirstLine h = new FirstLine(AsynchronousFileChannel.open(f.toPath(), StandardOpenOption.READ), cs, cf);
+			h.ch.read(h.buf, 0, null, h);
+		} catch(IOException ioe) {
+			cf.completeExceptionally(ioe);
+		}
+		return cf;
+	}
+
+	// Replaces the contents of f with the remaining bytes of buf.
+	public static CompletableFuture<Void> write(File f, ByteBuffer buf) {
+		CompletableFuture<Void> cf = new CompletableFuture<Void>();
+		try {
+			AsynchronousFileChannel ch = AsynchronousFileChannel.open(f.toPath(),
+				StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.TRUNCATE_EXISTING);
+			writeFrom(ch, buf, 0, cf);
+		} catch(IOException ioe) {
+			cf.completeExceptionally(ioe);
+		}
+		return cf;
+	}
+
+	private static void writeFrom(final AsynchronousFileChannel ch, final ByteBuffer buf, final long pos, final CompletableFuture<Void> cf) {
+		if(!buf.hasRemaining()) {
+			close(ch);
+			cf.complete(null);
+			return;
+		}
+		ch.write(buf, pos, null, new CompletionHandler<Integer, Void>() {
+			public void completed(Integer n, Void a) {
+				writeFrom(ch, buf, pos + n, cf);
+			}
+			public void failed(Throwable t, Void a) {
+				close(ch);
+				cf.completeExceptionally(t);
+			}
+		});
+	}
+
+	public static ByteBuffer encode(List<String> lines, Charset cs) {
+		byte[][] parts = new byte[lines.size()][];
+		int n = 0;
+		for(int i = 0; i < parts.length; i++) {
+			parts[i] = lines.get(i).getBytes(cs);
+			n += parts[i].length;
+		}
+		ByteBuffer b = ByteBuffer.allocate(n);
+		for(int i = 0; i < parts.length; i++)
+			b.put(parts[i]);
+		b.flip();
+		return b;
+	}
+
+	private static void close(AsynchronousFileChannel ch) {
+		try {
+			ch.close();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+	}
+
+	private static class FirstLine implements CompletionHandler<Integer, Void>
+	{
+
+		final AsynchronousFileChannel ch;
+
+		final Charset cs;
+
+		final CompletableFuture<String> cf;
+
+		ByteBuffer buf = BufferPool.acquire(8192);
+
+		FirstLine(AsynchronousFileChannel ch, Charset cs, CompletableFuture<String> cf) {
+			this.ch = ch;
+			this.cs = cs;
+			this.cf = cf;
+		}
+
+		public void completed(Integer n, Void a) {
+			int end = this.buf.position();
+			int eol = (n < 0) ? -1 : LineScanner.indexOfEol(this.buf, end - n, end);
+			if(n < 0 || eol >= 0) {
+				close(this.ch);
+				String line = (n < 0 && end == 0) ? null : new LineDecoder(this.cs).decode(this.buf, 0, (eol < 0) ? end : eol);
+				BufferPool.release(this.buf);
+				this.cf.complete(line);
+				return;
+			}
+			if(!this.buf.hasRemaining()) {
+				ByteBuffer b = BufferPool.acquire(this.buf.capacity() * 2);
+				this.buf.flip();
+				b.put(this.buf);
+				BufferPool.release(this.buf);
+				this.buf = b;
+			}
+			this.ch.read(this.buf, this.buf.position(), null, this);
+		}
+
+		public void failed(Throwable t, Void a) {
+			close(this.ch);
+			BufferPool.release(this.buf);
+			this.cf.completeExceptionally(t);
+		}
+
+	}
+
+}
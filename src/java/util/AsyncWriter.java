@@ -0,0 +1,213 @@
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+// Write-behind queue for one file. Callers enqueue batches into a bounded
+// queue and get a future back; a drain task on the Scheduler encodes
+// whatever has queued up through one pooled buffer, flushing once per
+// round. At most one drain task runs per writer, so batches land in the
+// file in the order they were enqueued, and Global.endProgram() drains
+// the queue.
+public class AsyncWriter implements Closeable
+{
+
+	public static final int DEFAULT_CAPACITY = 64;
+
+	private static final int MAX_COALESCE = 64;
+
+	private FileChannel ch;
+
+	// Only the drain task writes through it.
+	private LineWriter out;
+
+	private ArrayBlockingQueue<Batch> queue;
+
+	private AtomicBoolean scheduled = new AtomicBoolean();
+
+	private Runnable drain;
+
+	private volatile boolean closed;
+
+	// Calls to write() between their closed check and their enqueue.
+	private AtomicInteger writers = new AtomicInteger();
+
+	public AsyncWriter(File f, Charset cs) throws IOException {
+		this(f, cs, DEFAULT_CAPACITY, false);
+	}
+
+	public AsyncWriter(File f, Charset cs, int capacity, boolean append) throws IOException {
+		if(append)
+			this.ch = FileChannel.open(f.toPath(), StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.APPEND);
+		else
+			this.ch = FileChannel.open(f.toPath(), StandardOpenOption.CREATE, StandardOpenOption.WRITE, StandardOpenOption.TRUNCATE_EXISTING);
+		this.out = new LineWriter(this.ch, cs);
+		this.queue = new ArrayBlockingQueue<Batch>(capacity);
+		this.drain = this::close;
+		Global.onEnd(this.drain);
+	}
+
+	public boolean isClosed() {
+		return this.closed;
+	}
+
+	// Blocks only while the queue is full, without starving the Scheduler
+	// when called from one of its tasks. The batch is copied, so the
+	// caller may reuse its list as soon as this returns.
+	public CompletableFuture<Void> write(List<String> lines) {
+		Batch b = new Batch(new ArrayList<String>(lines));
+		this.writers.incrementAndGet();
+		try {
+			if(this.closed) b.done.completeExceptionally(new IOException("AsyncWriter is closed"));
+			else enqueue(b);
+		} finally {
+			if(this.writers.decrementAndGet() == 0 && this.closed) {
+				synchronized(this) {
+					notifyAll();
+				}
+			}
+		}
+		return b.done;
+	}
+
+	private void enqueue(Batch b) {
+		if(!this.queue.offer(b)) {
+			// On a Scheduler worker a plain put() would hold a thread the
+			// drain task may need; managedBlock lets the pool add one.
+			try {
+				ForkJoinPool.managedBlock(new Put(b));
+			} catch(InterruptedException ie) {
+				Thread.currentThread().interrupt();
+				b.done.completeExceptionally(ie);
+				return;
+			}
+		}
+		if(this.scheduled.compareAndSet(false, true))
+			Scheduler.execute(this::run);
+	}
+
+	private class Put implements ForkJoinPool.ManagedBlocker
+	{
+
+		private Batch b;
+
+		private boolean done;
+
+		Put(Batch b) {
+			this.b = b;
+		}
+
+		public boolean block() throws InterruptedException {
+			if(!this.done) {
+				queue.put(this.b);
+				this.done = true;
+			}
+			return true;
+		}
+
+		public boolean isReleasable() {
+			if(!this.done) this.done = queue.offer(this.b);
+			return this.done;
+		}
+
+	}
+
+	// Waits until every batch enqueued before this call is on disk.
+	public void flush() {
+		List<String> none = Collections.emptyList();
+		try {
+			write(none).join();
+		} catch(RuntimeException re) {
+			re.printStackTrace();
+		}
+	}
+
+	public void close() {
+		synchronized(this) {
+			if(this.closed) return;
+			this.closed = true;
+		}
+		Global.removeOnEnd(this.drain);
+		// Writers that saw the writer open finish enqueueing first, so
+		// their batches are ahead of the last one and get written.
+		boolean interrupted = false;
+		synchronized(this) {
+			while(this.writers.get() > 0) {
+				try {
+					wait();
+				} catch(InterruptedException ie) {
+					interrupted = true;
+				}
+			}
+		}
+		Batch last = new Batch(Collections.<String>emptyList());
+		enqueue(last);
+		try {
+			last.done.join();
+		} catch(RuntimeException re) {
+			re.printStackTrace();
+		}
+		try {
+			this.out.close();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		if(interrupted) Thread.currentThread().interrupt();
+	}
+
+	private void run() {
+		ArrayList<Batch> pending = new ArrayList<Batch>();
+		while(true) {
+			this.queue.drainTo(pending, MAX_COALESCE);
+			if(pending.isEmpty()) {
+				this.scheduled.set(false);
+				// A batch enqueued between drainTo and the reset above found the
+				// flag still set and did not schedule a task of its own.
+				if(this.queue.isEmpty() || !this.scheduled.compareAndSet(false, true)) return;
+				continue;
+			}
+			writeAll(pending);
+			pending.clear();
+		}
+	}
+
+	private void writeAll(List<Batch> batches) {
+		try {
+			for(int i = 0; i < batches.size(); i++) {
+				List<String> lines = batches.get(i).lines;
+				for(int k = 0; k < lines.size(); k++)
+					this.out.write(lines.get(k));
+			}
+			this.out.flush();
+			for(int i = 0; i < batches.size(); i++)
+				batches.get(i).done.complete(null);
+		} catch(IOException ioe) {
+			for(int i = 0; i < batches.size(); i++)
+				batches.get(i).done.completeExceptionally(ioe);
+		}
+	}
+
+	private static class Batch
+	{
+
+		final List<String> lines;
+
+		final CompletableFuture<Void> done = new CompletableFuture<Void>();
+
+		Batch(List<String> lines) {
+			this.lines = lines;
+		}
+
+	}
+
+}
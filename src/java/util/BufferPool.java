@@ -0,0 +1,132 @@
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.concurrent.ArrayBlockingQueue;
+
+// Direct ByteBuffers for I/O, recycled instead of allocated per call.
+// Capacities are powers of two from 4 KB to 4 MB. Each thread keeps a few
+// buffers of every size class, up to LOCAL_BYTES in all, so the cache
+// left behind by an idle thread stays small; releases beyond that go to a
+// bounded shared queue per class, and past that to the garbage collector.
+// Larger requests are served by plain allocations that are never pooled.
+// Pooled buffers start on a 4 KB boundary, so O_DIRECT transfers through
+// NativeFile reach the kernel without the runtime's bounce buffer.
+//
+// A buffer must be released at most once, by its last user, and not
+// touched afterwards.
+public class BufferPool
+{
+
+	private static final int MIN_SHIFT = 12;
+
+	private static final int MAX_SHIFT = 22;
+
+	private static final int CLASSES = MAX_SHIFT - MIN_SHIFT + 1;
+
+	// Matches File::ALIGN in the runtime.
+	private static final int ALIGN = 4096;
+
+	private static final int LOCAL_MAX = 4;
+
+	// Bytes one thread may keep to itself; set with -Dphoton.buffer.local.
+	static final long LOCAL_BYTES = Math.max(Long.getLong("photon.buffer.local", 1L << 20), 0);
+
+	private static final int SHARED_MAX = Math.max(Integer.getInteger("photon.buffer.shared", 32), 1);
+
+	// What readers and writers ask for unless told otherwise; set with
+	// -Dphoton.buffer.size.
+	public static final int DEFAULT_SIZE = Math.min(Math.max(Integer.getInteger("photon.buffer.size", 1 << 16),
+		1 << MIN_SHIFT), 1 << MAX_SHIFT);
+
+	private static final Metrics.Counter HITS = Metrics.counter("buffer.pool.hits");
+
+	private static final Metrics.Counter MISSES = Metrics.counter("buffer.pool.misses");
+
+	private static final ThreadLocal<Local> LOCAL = ThreadLocal.withInitial(Local::new);
+
+	private static final ArrayBlockingQueue<ByteBuffer>[] SHARED = shared();
+
+	@SuppressWarnings("unchecked")
+	private static ArrayBlockingQueue<ByteBuffer>[] shared() {
+		ArrayBlockingQueue<ByteBuffer>[] s = new ArrayBlockingQueue[CLASSES];
+		for(int i = 0; i < CLASSES; i++)
+			s[i] = new ArrayBlockingQueue<ByteBuffer>(SHARED_MAX);
+		return s;
+	}
+
+	private static class Local
+	{
+
+		final ByteBuffer[][] bufs = new ByteBuffer[CLASSES][LOCAL_MAX];
+
+		final int[] counts = new int[CLASSES];
+
+		long bytes;
+
+	}
+
+	public static ByteBuffer acquire() {
+		return acquire(DEFAULT_SIZE);
+	}
+
+	// A cleared, big-endian direct buffer of at least size bytes.
+	public static ByteBuffer acquire(int size) {
+		int c = sizeClass(size);
+		if(c < 0) {
+			MISSES.increment();
+			return ByteBuffer.allocateDirect(size);
+		}
+		Local l = LOCAL.get();
+		ByteBuffer b;
+		if(l.counts[c] > 0) {
+			b = l.bufs[c][--l.counts[c]];
+			l.bufs[c][l.counts[c]] = null;
+			l.bytes -= b.capacity();
+		} else {
+			b = SHARED[c].poll();
+		}
+		if(b == null) {
+			MISSES.increment();
+			return aligned(1 << (c + MIN_SHIFT));
+		}
+		HITS.increment();
+		b.clear();
+		b.order(ByteOrder.BIG_ENDIAN);
+		return b;
+	}
+
+	// cap bytes at an ALIGN boundary, cut from a block one page larger.
+	private static ByteBuffer aligned(int cap) {
+		ByteBuffer b = ByteBuffer.allocateDirect(cap + ALIGN).alignedSlice(ALIGN);
+		b.limit(cap);
+		return b.slice();
+	}
+
+	// Heap, read-only and odd-sized buffers are ignored, but any other
+	// direct buffer is pooled, so pass only what acquire() returned.
+	public static void release(ByteBuffer b) {
+		if(b == null || !b.isDirect() || b.isReadOnly()) return;
+		int cap = b.capacity();
+		if(Integer.bitCount(cap) != 1 || cap < (1 << MIN_SHIFT) || cap > (1 << MAX_SHIFT)) return;
+		int c = Integer.numberOfTrailingZeros(cap) - MIN_SHIFT;
+		Local l = LOCAL.get();
+		if(l.counts[c] < LOCAL_MAX && l.bytes + cap <= LOCAL_BYTES) {
+			l.bufs[c][l.counts[c]++] = b;
+			l.bytes += cap;
+			return;
+		}
+		SHARED[c].offer(b);
+	}
+
+	// What the calling thread's cache holds.
+	static long localBytes() {
+		return LOCAL.get().bytes;
+	}
+
+	// Index of the smallest class holding size bytes, or -1 past the last.
+	static int sizeClass(int size) {
+		if(size <= (1 << MIN_SHIFT)) return 0;
+		int shift = 32 - Integer.numberOfLeadingZeros(size - 1);
+		return (shift > MAX_SHIFT) ? -1 : shift - MIN_SHIFT;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+
+// One line as raw bytes in a reader's buffer. Nothing is decoded until
+// toString() is called, and the view is only valid until the next read
+// from the source that filled it.
+public class ByteLine
+{
+
+	private ByteBuffer buf;
+
+	private int off;
+
+	private int len;
+
+	private LineDecoder decoder;
+
+	public ByteLine(Charset cs) {
+		this.decoder = new LineDecoder(cs);
+	}
+
+	void set(ByteBuffer b, int off, int len) {
+		this.buf = b;
+		this.off = off;
+		this.len = len;
+	}
+
+	public int length() {
+		return this.len;
+	}
+
+	public byte byteAt(int i) {
+		if(i < 0 || i >= this.len) throw new IndexOutOfBoundsException("index " + i);
+		return this.buf.get(this.off + i);
+	}
+
+	public boolean isAscii() {
+		return LineDecoder.isAscii(this.buf, this.off, this.len);
+	}
+
+	public boolean startsWith(byte[] prefix) {
+		if(prefix.length > this.len) return false;
+		for(int i = 0; i < prefix.length; i++)
+			if(this.buf.get(this.off + i) != prefix[i]) return false;
+		return true;
+	}
+
+	public boolean contentEquals(byte[] b) {
+		return b.length == this.len && startsWith(b);
+	}
+
+	// Interned forms of the line and of its bytes [from, to), for keys
+	// and fields that repeat across many lines.
+	public String intern(StringTable t) {
+		return t.intern(this.buf, this.off, this.len, this.decoder);
+	}
+
+	public String intern(StringTable t, int from, int to) {
+		if(from < 0 || to > this.len || from > to) throw new IndexOutOfBoundsException("range [" + from + ", " + to + ")");
+		return t.intern(this.buf, this.off + from, to - from, this.decoder);
+	}
+
+	public String toString() {
+		return this.decoder.decode(this.buf, this.off, this.len);
+	}
+
+}
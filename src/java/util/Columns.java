@@ -0,0 +1,311 @@
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+import java.util.Arrays;
+
+// The fields of a delimited file, kept as byte ranges over one shared
+// buffer with a bounds array per selected column instead of a String per
+// field. Field delimiters and line ends are found with LineScanner.scan,
+// which runs on the native vector kernel when it is loaded. There is no
+// quoting: every delimiter byte ends a field, and a "\r\n" line end is
+// trimmed to its '\n'. Rows with too few fields get empty ones.
+public class Columns
+{
+
+	// Exact powers of ten; a double holds every one up to 1e22.
+	private static final double[] POW10 = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	private ByteBuffer data;
+
+	private LineDecoder dec;
+
+	private int[] selected;
+
+	// Slot of each column index, or -1 for a column that was not kept.
+	private int[] slots;
+
+	// Row r of slot s spans [bounds[s][2r], bounds[s][2r + 1]) in data.
+	private int[][] bounds;
+
+	private int rows;
+
+	private String[] names;
+
+	private Columns(ByteBuffer data, LineDecoder dec, int[] selected) {
+		this.data = data;
+		this.dec = dec;
+		this.selected = selected;
+		int max = -1;
+		for(int c : selected)
+			max = Math.max(max, c);
+		this.slots = new int[max + 1];
+		for(int i = 0; i < this.slots.length; i++)
+			this.slots[i] = -1;
+		for(int s = 0; s < selected.length; s++) {
+			if(selected[s] < 0) throw new IllegalArgumentException("Negative column: " + selected[s]);
+			if(this.slots[selected[s]] >= 0) throw new IllegalArgumentException("Column listed twice: " + selected[s]);
+			this.slots[selected[s]] = s;
+		}
+		// Grown by doubling; a guess from the size would overshoot on wide rows.
+		int cap = Math.max(16, Math.min(data.remaining() / 64, 1 << 16));
+		this.bounds = new int[selected.length][2 * cap];
+	}
+
+	// Splits the bytes in [position, limit) of data, keeping the columns
+	// listed in selected, or as many as the first row has when it is
+	// empty. With header set, the first row is taken as the column names
+	// rather than data.
+	public static Columns parse(ByteBuffer data, Charset cs, StringTable strings, byte delim, boolean header, int[] selected,
+			CancellationToken token) {
+		if(!LineScanner.isAsciiCompatible(cs))
+			throw new IllegalArgumentException("Delimited reads need an ASCII-compatible charset, not " + cs);
+		if(delim < 0 || delim == '\n' || delim == '\r')
+			throw new IllegalArgumentException("Delimiter must be an ASCII byte other than a line end");
+		if(selected.length == 0) selected = firstRow(data, delim);
+		Columns t = new Columns(data, new LineDecoder(cs, strings), selected);
+		t.split(data.position(), data.limit(), delim, token);
+		if(header && t.rows > 0) t.takeHeader();
+		return t;
+	}
+
+	private static int[] firstRow(ByteBuffer data, byte delim) {
+		int to = data.limit();
+		int eol = LineScanner.indexOf(data, (byte)'\n', data.position(), to);
+		if(eol < 0) eol = to;
+		int n = 1;
+		for(int i = data.position(); i < eol; i++)
+			if(data.get(i) == delim) n++;
+		int[] all = new int[n];
+		for(int i = 0; i < n; i++)
+			all[i] = i;
+		return all;
+	}
+
+	private void split(int from, int to, byte delim, CancellationToken token) {
+		int[] hits = new int[4096];
+		int field = 0;
+		int start = from;
+		int i = from;
+		while(i < to) {
+			int n = LineScanner.scan(this.data, i, to, delim, (byte)'\n', hits);
+			for(int k = 0; k < n; k++) {
+				int p = hits[k];
+				if(this.data.get(p) == delim) {
+					add(field++, start, p);
+				} else {
+					int end = (p > start && this.data.get(p - 1) == '\r') ? p - 1 : p;
+					add(field, start, end);
+					endRow(field + 1, p);
+					field = 0;
+					if((this.rows & SFileStream.CHECK_MASK) == 0) token.throwIfCancelled();
+				}
+				start = p + 1;
+			}
+			if(n < hits.length) break;
+			i = hits[n - 1] + 1;
+		}
+		// A last line without a terminator.
+		if(start < to || field > 0) {
+			int end = (to > start && this.data.get(to - 1) == '\r') ? to - 1 : to;
+			add(field, start, end);
+			endRow(field + 1, to);
+		}
+	}
+
+	private void add(int field, int start, int end) {
+		if(field >= this.slots.length) return;
+		int s = this.slots[field];
+		if(s < 0) return;
+		int[] b = this.bounds[s];
+		if(2 * this.rows + 1 >= b.length) {
+			b = Arrays.copyOf(b, b.length * 2);
+			this.bounds[s] = b;
+		}
+		b[2 * this.rows] = start;
+		b[2 * this.rows + 1] = end;
+	}
+
+	// Fills in the kept columns a short row did not reach.
+	private void endRow(int fields, int at) {
+		for(int c = fields; c < this.slots.length; c++)
+			add(c, at, at);
+		this.rows++;
+	}
+
+	private void takeHeader() {
+		this.names = new String[this.selected.length];
+		for(int s = 0; s < this.selected.length; s++) {
+			int[] b = this.bounds[s];
+			this.names[s] = this.dec.decode(this.data, b[0], b[1] - b[0]);
+			System.arraycopy(b, 2, b, 0, 2 * (this.rows - 1));
+		}
+		this.rows--;
+	}
+
+	public int rowCount() {
+		return this.rows;
+	}
+
+	// The column indexes that were kept, in the order they were asked for.
+	public int[] columns() {
+		return this.selected.clone();
+	}
+
+	// The header name of column c, or null when there was no header.
+	public String name(int c) {
+		return (this.names == null) ? null : this.names[slot(c)];
+	}
+
+	// The first column with the given header name, or -1.
+	public int column(String name) {
+		if(this.names != null)
+			for(int s = 0; s < this.names.length; s++)
+				if(this.names[s].equals(name)) return this.selected[s];
+		return -1;
+	}
+
+	private int slot(int c) {
+		int s = (c >= 0 && c < this.slots.length) ? this.slots[c] : -1;
+		if(s < 0) throw new IllegalArgumentException("Column " + c + " was not read");
+		return s;
+	}
+
+	// The buffer every field points into.
+	public ByteBuffer buffer() {
+		return this.data;
+	}
+
+	// Field r of column c spans [start(r, c), end(r, c)) in buffer().
+	public int start(int r, int c) {
+		return this.bounds[slot(c)][2 * checkRow(r)];
+	}
+
+	public int end(int r, int c) {
+		return this.bounds[slot(c)][2 * checkRow(r) + 1];
+	}
+
+	private int checkRow(int r) {
+		if(r < 0 || r >= this.rows) throw new IndexOutOfBoundsException("Row " + r + " of " + this.rows);
+		return r;
+	}
+
+	public String get(int r, int c) {
+		int[] b = this.bounds[slot(c)];
+		int i = 2 * checkRow(r);
+		return this.dec.decode(this.data, b[i], b[i + 1] - b[i]);
+	}
+
+	// Column c parsed as decimal ints straight from the bytes. Throws
+	// NumberFormatException on an empty field, a stray character or
+	// overflow.
+	public int[] ints(int c) {
+		int[] b = this.bounds[slot(c)];
+		int[] out = new int[this.rows];
+		for(int r = 0; r < this.rows; r++)
+			out[r] = parseInt(b[2 * r], b[2 * r + 1], r, c);
+		return out;
+	}
+
+	// Column c parsed as doubles. Plain decimals with up to 15 significant
+	// digits are converted from the bytes; anything else, such as
+	// exponents, NaN or longer mantissas, goes through Double.parseDouble.
+	public double[] doubles(int c) {
+		int[] b = this.bounds[slot(c)];
+		double[] out = new double[this.rows];
+		for(int r = 0; r < this.rows; r++)
+			out[r] = parseDouble(b[2 * r], b[2 * r + 1], r, c);
+		return out;
+	}
+
+	private int parseInt(int from, int to, int r, int c) {
+		int i = from;
+		boolean neg = false;
+		if(i < to && (this.data.get(i) == '-' || this.data.get(i) == '+')) neg = this.data.get(i++) == '-';
+		if(i == to) throw badNumber(from, to, r, c);
+		long v = 0;
+		for(; i < to; i++) {
+			int d = this.data.get(i) - '0';
+			if(d < 0 || d > 9) throw badNumber(from, to, r, c);
+			v = v * 10 + d;
+			if(v > 1L + Integer.MAX_VALUE) throw badNumber(from, to, r, c);
+		}
+		if(neg) v = -v;
+		if(v > Integer.MAX_VALUE) throw badNumber(from, to, r, c);
+		return (int)v;
+	}
+
+	private double parseDouble(int from, int to, int r, int c) {
+		int i = from;
+		boolean neg = false;
+		if(i < to && (this.data.get(i) == '-' || this.data.get(i) == '+')) neg = this.data.get(i++) == '-';
+		long m = 0;
+		int seen = 0;
+		int digits = 0;
+		int frac = -1;
+		for(; i < to; i++) {
+			byte ch = this.data.get(i);
+			if(ch == '.' && frac < 0) {
+				frac = 0;
+				continue;
+			}
+			int d = ch - '0';
+			if(d < 0 || d > 9) break;
+			seen++;
+			if(m != 0 || d != 0) digits++;
+			m = m * 10 + d;
+			if(frac >= 0) frac++;
+		}
+		// m is exact below 2^53, and so is the one division by a power of
+		// ten, which keeps the result correctly rounded.
+		if(i == to && seen > 0 && digits <= 15 && frac <= 22) {
+			double v = (frac > 0) ? m / POW10[frac] : m;
+			return neg ? -v : v;
+		}
+		// Double.parseDouble also takes type suffixes, hex and surrounding
+		// whitespace, none of which belong in a column.
+		if(!isDecimal(from, to)) throw badNumber(from, to, r, c);
+		return Double.parseDouble(this.dec.newString(this.data, from, to - from));
+	}
+
+	// [+-]digits[.digits][(e|E)[+-]digits], with a digit on at least one
+	// side of the point, or NaN and Infinity as Double.toString writes them.
+	private boolean isDecimal(int from, int to) {
+		int i = from;
+		if(i < to && (this.data.get(i) == '-' || this.data.get(i) == '+')) i++;
+		if(isWord(i, to, "NaN") || isWord(i, to, "Infinity")) return true;
+		int digits = 0;
+		for(; i < to && isDigit(this.data.get(i)); i++)
+			digits++;
+		if(i < to && this.data.get(i) == '.')
+			for(i++; i < to && isDigit(this.data.get(i)); i++)
+				digits++;
+		if(digits == 0) return false;
+		if(i < to && (this.data.get(i) == 'e' || this.data.get(i) == 'E')) {
+			i++;
+			if(i < to && (this.data.get(i) == '-' || this.data.get(i) == '+')) i++;
+			int exp = i;
+			while(i < to && isDigit(this.data.get(i)))
+				i++;
+			if(i == exp) return false;
+		}
+		return i == to;
+	}
+
+	private boolean isWord(int from, int to, String w) {
+		if(to - from != w.length()) return false;
+		for(int i = 0; i < w.length(); i++)
+			if(this.data.get(from + i) != w.charAt(i)) return false;
+		return true;
+	}
+
+	private static boolean isDigit(byte b) {
+		return b >= '0' && b <= '9';
+	}
+
+	private NumberFormatException badNumber(int from, int to, int r, int c) {
+		return new NumberFormatException("Row " + r + ", column " + c + ": \"" + this.dec.newString(this.data, from, to - from) + "\"");
+	}
+
+}
\ No newline at end of file
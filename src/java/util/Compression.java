@@ -0,0 +1,382 @@
+import java.io.ByteArrayOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.Channels;
+import java.nio.channels.FileChannel;
+import java.nio.channels.ReadableByteChannel;
+import java.nio.channels.SeekableByteChannel;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Future;
+import java.util.zip.CRC32;
+import java.util.zip.DataFormatException;
+import java.util.zip.GZIPInputStream;
+import java.util.zip.Inflater;
+
+// Compressed input, recognised by its magic bytes. gzip is inflated as a
+// stream; BGZF, a gzip variant made of independent blocks of at most
+// 64 KB that records each block's size in its header, can also be
+// inflated block-parallel on a pool; zstd needs the native runtime built
+// with libzstd.
+public class Compression
+{
+
+	public enum Format { NONE, GZIP, BGZF, ZSTD }
+
+	// Enough for a gzip header with the 6-byte BGZF extra field.
+	private static final int HEADER = 18;
+
+	private static final long GROUP_BYTES = 1L << 20;
+
+	private static final int GROUP_BLOCKS = 256;
+
+	private static final int ZSTD_BUFFER = 1 << 17;
+
+	public static Format detect(File f) throws IOException {
+		FileInputStream in = new FileInputStream(f);
+		try {
+			return detect(in.getChannel());
+		} finally {
+			in.close();
+		}
+	}
+
+	// Reads the header from the start of ch, leaving ch where it was.
+	public static Format detect(SeekableByteChannel ch) throws IOException {
+		ByteBuffer b = ByteBuffer.allocate(HEADER);
+		long p = ch.position();
+		ch.position(0);
+		try {
+			while(b.hasRemaining())
+				if(ch.read(b) < 0) break;
+		} finally {
+			ch.position(p);
+		}
+		b.flip();
+		return detect(b);
+	}
+
+	// Looks at the bytes in [0, limit) of b.
+	public static Format detect(ByteBuffer b) {
+		int n = b.limit();
+		if(n >= 4 && u8(b, 0) == 0x28 && u8(b, 1) == 0xb5 && u8(b, 2) == 0x2f && u8(b, 3) == 0xfd)
+			return Format.ZSTD;
+		if(n >= 3 && u8(b, 0) == 0x1f && u8(b, 1) == 0x8b && u8(b, 2) == 8)
+			return (blockSize(b, 0, n) > 0) ? Format.BGZF : Format.GZIP;
+		return Format.NONE;
+	}
+
+	// The decompressed bytes of a file whose format detect() returned.
+	// Closing the stream closes ch.
+	public static InputStream open(ReadableByteChannel ch, Format fmt) throws IOException {
+		switch(fmt) {
+			case GZIP:
+			case BGZF:
+				return new GZIPInputStream(Channels.newInputStream(ch), 1 << 16);
+			case ZSTD:
+				if(!Native.isAvailable() || !Native.zstdAvailable()) {
+					ch.close();
+					throw new IOException("Reading zstd input needs the native runtime built with libzstd");
+				}
+				return new ZstdStream(ch);
+			default:
+				return Channels.newInputStream(ch);
+		}
+	}
+
+	private static int u8(ByteBuffer b, int i) {
+		return b.get(i) & 0xff;
+	}
+
+	private static int u16(ByteBuffer b, int i) {
+		return u8(b, i) | (u8(b, i + 1) << 8);
+	}
+
+	// Total size of the BGZF block whose header starts at off, or -1 when
+	// the bytes in [off, n) do not start one.
+	static int blockSize(ByteBuffer b, int off, int n) {
+		if(n - off < HEADER || u8(b, off) != 0x1f || u8(b, off + 1) != 0x8b || u8(b, off + 2) != 8)
+			return -1;
+		if((u8(b, off + 3) & 4) == 0) return -1;
+		int p = off + 12;
+		int end = Math.min(p + u16(b, off + 10), n);
+		while(p + 4 <= end) {
+			int slen = u16(b, p + 2);
+			if(u8(b, p) == 'B' && u8(b, p + 1) == 'C' && slen == 2 && p + 6 <= end)
+				return u16(b, p + 4) + 1;
+			p += 4 + slen;
+		}
+		return -1;
+	}
+
+	// Inflates a BGZF file in groups of blocks on pool and splits each
+	// group into lines there too; only the lines that cross a group
+	// boundary are joined afterwards. Results come back in file order.
+	public static List<List<String>> readBgzf(File f, Charset cs, StringTable strings, ExecutorService pool,
+			CancellationToken token) throws IOException {
+		return readBgzf(f, cs, strings, pool, token, GROUP_BYTES);
+	}
+
+	static List<List<String>> readBgzf(File f, Charset cs, StringTable strings, ExecutorService pool,
+			CancellationToken token, long groupBytes) throws IOException {
+		FileInputStream in = new FileInputStream(f);
+		try {
+			FileChannel ch = in.getChannel();
+			long size = ch.size();
+			ArrayList<Future<Piece>> parts = new ArrayList<Future<Piece>>();
+			ByteBuffer hdr = ByteBuffer.allocate(HEADER);
+			long pos = 0;
+			long start = 0;
+			int blocks = 0;
+			while(pos < size) {
+				hdr.clear();
+				while(hdr.hasRemaining())
+					if(ch.read(hdr, pos + hdr.position()) < 0) break;
+				int bs = blockSize(hdr, 0, hdr.position());
+				if(bs < 0 || pos + bs > size) throw new IOException("Bad BGZF block at offset " + pos + " in " + f);
+				pos += bs;
+				blocks++;
+				if(pos - start >= groupBytes || blocks == GROUP_BLOCKS || pos == size) {
+					parts.add(pool.submit(new Blocks(ch, start, pos, cs, strings, token)));
+					start = pos;
+					blocks = 0;
+				}
+			}
+			try {
+				return stitch(parts, new LineDecoder(cs, strings));
+			} catch(IOException | RuntimeException e) {
+				for(int i = 0; i < parts.size(); i++)
+					parts.get(i).cancel(false);
+				throw e;
+			}
+		} finally {
+			in.close();
+		}
+	}
+
+	private static List<List<String>> stitch(List<Future<Piece>> parts, LineDecoder dec) throws IOException {
+		ArrayList<List<String>> out = new ArrayList<List<String>>(parts.size() * 2 + 1);
+		ByteArrayOutputStream carry = new ByteArrayOutputStream();
+		for(int i = 0; i < parts.size(); i++) {
+			Piece p = join(parts.get(i));
+			carry.write(p.head, 0, p.head.length);
+			if(p.lines == null) continue;
+			// The head ends with its '\n', so the carry is now whole lines.
+			out.add(split(carry.toByteArray(), dec));
+			out.add(p.lines);
+			carry.reset();
+			carry.write(p.tail, 0, p.tail.length);
+		}
+		if(carry.size() > 0) out.add(split(carry.toByteArray(), dec));
+		return out;
+	}
+
+	private static List<String> split(byte[] b, LineDecoder dec) {
+		ArrayList<String> lines = new ArrayList<String>(1);
+		LineScanner.split(ByteBuffer.wrap(b), 0, b.length, dec, lines);
+		return lines;
+	}
+
+	private static <T> T join(Future<T> fut) throws IOException {
+		try {
+			return fut.get();
+		} catch(InterruptedException ie) {
+			Thread.currentThread().interrupt();
+			throw new IOException("Interrupted while reading", ie);
+		} catch(ExecutionException ee) {
+			if(ee.getCause() instanceof IOException) throw (IOException)ee.getCause();
+			if(ee.getCause() instanceof RuntimeException) throw (RuntimeException)ee.getCause();
+			throw new IOException(ee.getCause());
+		}
+	}
+
+	// One group's text: the bytes up to and including its first '\n', the
+	// complete lines after that, and the bytes after its last '\n'. A group
+	// without any '\n' is all head and has no lines.
+	private static class Piece
+	{
+
+		final byte[] head;
+
+		final List<String> lines;
+
+		final byte[] tail;
+
+		Piece(byte[] head, List<String> lines, byte[] tail) {
+			this.head = head;
+			this.lines = lines;
+			this.tail = tail;
+		}
+
+	}
+
+	private static class Blocks implements Callable<Piece>
+	{
+
+		private FileChannel ch;
+
+		private long start;
+
+		private long end;
+
+		private Charset cs;
+
+		private StringTable strings;
+
+		private CancellationToken token;
+
+		Blocks(FileChannel ch, long start, long end, Charset cs, StringTable strings, CancellationToken token) {
+			this.ch = ch;
+			this.start = start;
+			this.end = end;
+			this.cs = cs;
+			this.strings = strings;
+			this.token = token;
+		}
+
+		public Piece call() throws IOException {
+			this.token.throwIfCancelled();
+			int n = (int)(this.end - this.start);
+			ByteBuffer raw = ByteBuffer.allocate(n).order(ByteOrder.LITTLE_ENDIAN);
+			while(raw.hasRemaining())
+				if(this.ch.read(raw, this.start + raw.position()) < 0) throw new IOException("BGZF file shrank while reading");
+			// The trailer of every block records its inflated size.
+			long total = 0;
+			for(int off = 0; off < n; ) {
+				int bs = blockSize(raw, off, n);
+				if(bs < 0 || off + bs > n) throw new IOException("BGZF file changed while reading");
+				total += raw.getInt(off + bs - 4) & 0xffffffffL;
+				off += bs;
+			}
+			if(total > Integer.MAX_VALUE - 8) throw new IOException("BGZF group too large");
+			byte[] data = new byte[(int)total];
+			Inflater inf = new Inflater(true);
+			CRC32 crc = new CRC32();
+			try {
+				int at = 0;
+				for(int off = 0; off < n; ) {
+					int bs = blockSize(raw, off, n);
+					int cdata = off + 12 + u16(raw, off + 10);
+					int isize = raw.getInt(off + bs - 4);
+					inf.reset();
+					// Giving the inflater the trailer too is harmless; it stops at
+					// the end of the deflate stream.
+					inf.setInput(raw.array(), cdata, off + bs - cdata);
+					int got = 0;
+					while(got < isize && !inf.finished()) {
+						int k = inf.inflate(data, at + got, isize - got);
+						if(k == 0 && (inf.needsInput() || inf.needsDictionary())) break;
+						got += k;
+					}
+					crc.reset();
+					crc.update(data, at, got);
+					if(got != isize || (int)crc.getValue() != raw.getInt(off + bs - 8))
+						throw new IOException("Corrupt BGZF block at offset " + (this.start + off));
+					at += got;
+					off += bs;
+				}
+			} catch(DataFormatException dfe) {
+				throw new IOException("Corrupt BGZF data: " + dfe.getMessage(), dfe);
+			} finally {
+				inf.end();
+			}
+			ByteBuffer b = ByteBuffer.wrap(data);
+			int first = LineScanner.indexOfAny(b, (byte)'\n', (byte)'\n', 0, data.length);
+			if(first < 0) return new Piece(data, null, null);
+			int last = LineScanner.lastIndexOf(b, (byte)'\n', first, data.length);
+			ArrayList<String> lines = new ArrayList<String>();
+			LineScanner.split(b, first + 1, last + 1, new LineDecoder(this.cs, this.strings), lines);
+			return new Piece(Arrays.copyOfRange(data, 0, first + 1), lines, Arrays.copyOfRange(data, last + 1, data.length));
+		}
+
+	}
+
+	// Streams zstd frames through the native decoder, reading compressed
+	// bytes straight from the channel into a direct buffer. Frames are
+	// decoded one after another: a frame header does not record its
+	// compressed size, so unlike BGZF the boundaries are only known once
+	// the frame before has been decoded.
+	private static class ZstdStream extends InputStream
+	{
+
+		private ReadableByteChannel ch;
+
+		private long handle;
+
+		private ByteBuffer src = BufferPool.acquire(ZSTD_BUFFER);
+
+		private ByteBuffer dst = BufferPool.acquire(ZSTD_BUFFER);
+
+		private int[] counts = new int[2];
+
+		private boolean eof;
+
+		// False while a frame has been started but not finished.
+		private boolean frameDone = true;
+
+		ZstdStream(ReadableByteChannel ch) {
+			this.ch = ch;
+			this.handle = Native.zstdOpen();
+			this.src.limit(0);
+			this.dst.limit(0);
+		}
+
+		public int read() throws IOException {
+			byte[] one = new byte[1];
+			return (read(one, 0, 1) < 0) ? -1 : one[0] & 0xff;
+		}
+
+		public int read(byte[] b, int off, int len) throws IOException {
+			if(len == 0) return 0;
+			while(!this.dst.hasRemaining())
+				if(!fill()) return -1;
+			int n = Math.min(len, this.dst.remaining());
+			this.dst.get(b, off, n);
+			return n;
+		}
+
+		// Decodes more output into dst; false at the end of the input.
+		private boolean fill() throws IOException {
+			if(this.handle == 0) throw new IOException("Stream closed");
+			while(true) {
+				if(!this.src.hasRemaining() && !this.eof) {
+					this.src.clear();
+					this.eof = this.ch.read(this.src) < 0;
+					this.src.flip();
+				}
+				if(!this.src.hasRemaining() && this.eof) {
+					if(!this.frameDone) throw new IOException("Truncated zstd input");
+					return false;
+				}
+				this.dst.clear();
+				int r = Native.zstdDecompress(this.handle, this.src, this.src.position(), this.src.limit(),
+					this.dst, 0, this.dst.capacity(), this.counts);
+				this.src.position(this.src.position() + this.counts[0]);
+				this.dst.limit(this.counts[1]);
+				if(this.counts[0] > 0 || this.counts[1] > 0 || r == 1) this.frameDone = (r == 1);
+				if(this.counts[1] > 0) return true;
+			}
+		}
+
+		public void close() throws IOException {
+			if(this.handle != 0) {
+				Native.zstdClose(this.handle);
+				this.handle = 0;
+				BufferPool.release(this.src);
+				BufferPool.release(this.dst);
+			}
+			this.ch.close();
+		}
+
+	}
+
+}
\ No newline at end of file
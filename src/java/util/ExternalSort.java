@@ -0,0 +1,282 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.List;
+import java.util.PriorityQueue;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+
+// Sorts the lines of a file that may be far larger than the heap. Lines
+// are read into chunks that together fit the memory budget, each chunk
+// is sorted and spilled as a run of records (see RecordWriter) by a task
+// on the Scheduler while the next one fills, and the runs are then merged
+// k ways through readers that decode their next batch ahead on the
+// Scheduler. More than MAX_FAN_IN runs are merged in several passes. The
+// sort is stable, and input that fits one chunk never touches the disk.
+// Runs go to -Dphoton.sort.dir, or next to the output file. Each line is
+// written out with a '\n' after it; in the runs, records frame them.
+// Runs hold lines as UTF-8, which would turn a lone surrogate into '?',
+// but lines come from a charset decoder, which replaces malformed input
+// and so never yields one; the round trip is exact.
+class ExternalSort
+{
+
+	static final int MAX_FAN_IN = 64;
+
+	// Rough heap cost of a String beyond its chars, with its list slot.
+	private static final int LINE_OVERHEAD = 64;
+
+	private static final long MIN_BUDGET = 1 << 20;
+
+	private Comparator<String> cmp;
+
+	private long budget;
+
+	private CancellationToken token;
+
+	private File dir;
+
+	private ArrayList<File> spilled = new ArrayList<File>();
+
+	private long lines;
+
+	ExternalSort(Comparator<String> cmp, long budget, CancellationToken token, File dir) {
+		this.cmp = cmp;
+		this.budget = Math.max(budget, MIN_BUDGET);
+		this.token = token;
+		this.dir = dir;
+	}
+
+	// Returns the number of lines written. Run files are removed whether
+	// or not the sort succeeds.
+	long sort(LineSource in, LineWriter out) throws IOException {
+		try {
+			List<File> runs = spill(in, out);
+			if(runs == null) return this.lines;
+			while(runs.size() > MAX_FAN_IN) {
+				ArrayList<File> next = new ArrayList<File>();
+				for(int i = 0; i < runs.size(); i += MAX_FAN_IN) {
+					List<File> group = runs.subList(i, Math.min(i + MAX_FAN_IN, runs.size()));
+					File f = newRun();
+					RecordWriter w = new RecordWriter(f, false, false, RecordWriter.DEFAULT_BLOCK);
+					try {
+						merge(group, line -> w.write(line.getBytes(StandardCharsets.UTF_8)));
+					} finally {
+						w.close();
+					}
+					for(File g : group)
+						g.delete();
+					next.add(f);
+				}
+				runs = next;
+			}
+			return merge(runs, out::writeLine);
+		} finally {
+			for(File f : this.spilled)
+				f.delete();
+		}
+	}
+
+	// Fills chunks of budget / (parallelism + 1) and hands each to a sort
+	// task; at most parallelism of them are sorting at once, so the heap
+	// holds the chunk being filled plus those. Returns null, having
+	// written the output itself, when everything fitted one chunk.
+	private List<File> spill(LineSource in, LineWriter out) throws IOException {
+		int tasks = Math.max(Scheduler.parallelism(), 1);
+		long chunkBytes = this.budget / (tasks + 1);
+		ArrayList<File> runs = new ArrayList<File>();
+		ArrayDeque<Future<File>> sorting = new ArrayDeque<Future<File>>();
+		try {
+			while(true) {
+				ArrayList<String> chunk = new ArrayList<String>();
+				long bytes = 0;
+				String s = null;
+				while(bytes < chunkBytes && (s = in.readLine()) != null) {
+					chunk.add(s);
+					bytes += LINE_OVERHEAD + 2L * s.length();
+					if((chunk.size() & SFileStream.CHECK_MASK) == 0) this.token.throwIfCancelled();
+				}
+				this.lines += chunk.size();
+				if(s == null && runs.isEmpty() && sorting.isEmpty()) {
+					chunk.sort(this.cmp);
+					for(int i = 0; i < chunk.size(); i++)
+						out.writeLine(chunk.get(i));
+					return null;
+				}
+				if(!chunk.isEmpty()) {
+					if(sorting.size() == tasks) runs.add(await(sorting.poll()));
+					File f = newRun();
+					sorting.add(Scheduler.submit(() -> writeRun(chunk, f)));
+				}
+				if(s == null) break;
+			}
+			while(!sorting.isEmpty())
+				runs.add(await(sorting.poll()));
+		} finally {
+			// Tasks still going after a failure must not outlive the sort.
+			for(Future<File> f : sorting)
+				try {
+					f.get();
+				} catch(InterruptedException | ExecutionException e) {
+				}
+		}
+		return runs;
+	}
+
+	private File writeRun(List<String> chunk, File f) throws IOException {
+		chunk.sort(this.cmp);
+		RecordWriter w = new RecordWriter(f, false, false, RecordWriter.DEFAULT_BLOCK);
+		try {
+			for(int i = 0; i < chunk.size(); i++)
+				w.write(chunk.get(i).getBytes(StandardCharsets.UTF_8));
+		} finally {
+			w.close();
+		}
+		return f;
+	}
+
+	private File newRun() throws IOException {
+		File f = File.createTempFile("photon-sort", ".run", this.dir);
+		this.spilled.add(f);
+		return f;
+	}
+
+	private static File await(Future<File> f) throws IOException {
+		try {
+			return f.get();
+		} catch(InterruptedException ie) {
+			Thread.currentThread().interrupt();
+			throw new IOException("Interrupted while sorting", ie);
+		} catch(ExecutionException ee) {
+			Throwable t = ee.getCause();
+			if(t instanceof IOException) throw (IOException)t;
+			if(t instanceof RuntimeException) throw (RuntimeException)t;
+			throw new IOException(t);
+		}
+	}
+
+	private interface Sink
+	{
+
+		void write(String line) throws IOException;
+
+	}
+
+	// Ties go to the earlier run, which keeps the sort stable.
+	private long merge(List<File> runs, Sink out) throws IOException {
+		// Two batches per run are in memory: the one being merged and the
+		// one being read ahead.
+		long batchBytes = Math.max(this.budget / (2L * runs.size()), 1 << 16);
+		ArrayList<Run> open = new ArrayList<Run>();
+		PriorityQueue<Run> heap = new PriorityQueue<Run>(Math.max(runs.size(), 1), (a, b) -> {
+			int c = this.cmp.compare(a.head(), b.head());
+			return (c != 0) ? c : Integer.compare(a.order, b.order);
+		});
+		long n = 0;
+		try {
+			for(int i = 0; i < runs.size(); i++) {
+				Run r = new Run(runs.get(i), i, batchBytes);
+				open.add(r);
+				if(r.advance()) heap.add(r);
+			}
+			while(!heap.isEmpty()) {
+				Run r = heap.poll();
+				out.write(r.head());
+				if((++n & SFileStream.CHECK_MASK) == 0) this.token.throwIfCancelled();
+				if(r.advance()) heap.add(r);
+			}
+		} finally {
+			for(Run r : open)
+				r.close();
+		}
+		return n;
+	}
+
+	// A cursor over one run. While the merge works through one batch, the
+	// next is decoded by a task on the Scheduler; only that task touches
+	// the reader between handoffs.
+	private static class Run
+	{
+
+		final int order;
+
+		private RecordReader reader;
+
+		private long batchBytes;
+
+		private List<String> batch;
+
+		private int pos;
+
+		private CompletableFuture<List<String>> ahead;
+
+		Run(File f, int order, long batchBytes) throws IOException {
+			this.order = order;
+			this.reader = new RecordReader(f);
+			this.batchBytes = batchBytes;
+			try {
+				this.ahead = CompletableFuture.completedFuture(read());
+			} catch(IOException | RuntimeException e) {
+				this.reader.close();
+				throw e;
+			}
+		}
+
+		String head() {
+			return this.batch.get(this.pos);
+		}
+
+		// Moves to the next line; false after the last one.
+		boolean advance() throws IOException {
+			if(this.batch != null && ++this.pos < this.batch.size()) return true;
+			try {
+				this.batch = this.ahead.join();
+			} catch(CompletionException ce) {
+				Throwable t = ce.getCause();
+				if(t instanceof IOException) throw (IOException)t;
+				throw ce;
+			}
+			this.pos = 0;
+			if(this.batch.isEmpty()) return false;
+			this.ahead = Scheduler.supply(() -> {
+				try {
+					return read();
+				} catch(IOException ioe) {
+					throw new CompletionException(ioe);
+				}
+			});
+			return true;
+		}
+
+		private List<String> read() throws IOException {
+			ArrayList<String> b = new ArrayList<String>();
+			long bytes = 0;
+			while(bytes < this.batchBytes) {
+				byte[] r = this.reader.next();
+				if(r == null) break;
+				b.add(new String(r, StandardCharsets.UTF_8));
+				bytes += LINE_OVERHEAD + 2L * r.length;
+			}
+			return b;
+		}
+
+		void close() {
+			try {
+				this.ahead.join();
+			} catch(RuntimeException re) {
+			}
+			try {
+				this.reader.close();
+			} catch(IOException ioe) {
+				ioe.printStackTrace();
+			}
+		}
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.charset.Charset;
+import java.nio.file.Files;
+import java.nio.file.attribute.BasicFileAttributes;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.function.Supplier;
+
+// Process-wide cache of decoded lines, keyed by canonical path and
+// charset, and checked against the file's size and mtime on every lookup
+// so a changed file is never served stale. Lookups take no lock; the
+// cache is bounded by an estimate of the memory its entries hold, and the
+// least recently used entries are evicted first.
+public class FileCache
+{
+
+	public static final long DEFAULT_MAX_BYTES = 64L << 20;
+
+	// Rough heap cost of one cached String beyond its characters.
+	private static final long LINE_OVERHEAD = 48;
+
+	private static final FileCache shared = new FileCache(Long.getLong("photon.cache.bytes", DEFAULT_MAX_BYTES));
+
+	private static final Metrics.Counter HITS = Metrics.counter("sfile.cache.hits");
+
+	private static final Metrics.Counter MISSES = Metrics.counter("sfile.cache.misses");
+
+	private final long maxBytes;
+
+	private final ConcurrentHashMap<String, Entry> entries = new ConcurrentHashMap<String, Entry>();
+
+	private final AtomicLong clock = new AtomicLong();
+
+	private long bytes;
+
+	public FileCache(long maxBytes) {
+		this.maxBytes = maxBytes;
+	}
+
+	// Sized by -Dphoton.cache.bytes.
+	public static FileCache shared() {
+		return shared;
+	}
+
+	// The lines of f, from the cache when it still matches the file and
+	// from load otherwise. The file is stat'ed before load runs, so a
+	// change made during the load is caught by the next lookup. load
+	// returns null when the read fails; that is passed back uncached.
+	public List<String> lines(File f, Charset cs, Supplier<? extends List<String>> load) {
+		String key;
+		BasicFileAttributes attrs;
+		try {
+			key = f.getCanonicalPath() + '\0' + cs.name();
+			attrs = Files.readAttributes(f.toPath(), BasicFileAttributes.class);
+		} catch(IOException ioe) {
+			return load.get();
+		}
+		long size = attrs.size();
+		long modified = attrs.lastModifiedTime().toMillis();
+		Entry e = this.entries.get(key);
+		if(e != null && e.size == size && e.modified == modified) {
+			e.used = this.clock.incrementAndGet();
+			HITS.increment();
+			return Collections.unmodifiableList(Arrays.asList(e.lines));
+		}
+		MISSES.increment();
+		List<String> lines = load.get();
+		if(lines == null) return null;
+		put(key, new Entry(lines.toArray(new String[0]), size, modified));
+		return lines;
+	}
+
+	public void invalidate(File f) {
+		try {
+			String prefix = f.getCanonicalPath() + '\0';
+			for(String key : this.entries.keySet())
+				if(key.startsWith(prefix)) remove(key);
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+	}
+
+	public synchronized void clear() {
+		this.entries.clear();
+		this.bytes = 0;
+	}
+
+	public int size() {
+		return this.entries.size();
+	}
+
+	public synchronized long bytes() {
+		return this.bytes;
+	}
+
+	private synchronized void put(String key, Entry e) {
+		if(e.weight > this.maxBytes) return;
+		e.used = this.clock.incrementAndGet();
+		Entry old = this.entries.put(key, e);
+		this.bytes += e.weight - ((old != null) ? old.weight : 0);
+		while(this.bytes > this.maxBytes) {
+			String lru = null;
+			long oldest = Long.MAX_VALUE;
+			for(Map.Entry<String, Entry> m : this.entries.entrySet()) {
+				if(m.getValue().used < oldest) {
+					oldest = m.getValue().used;
+					lru = m.getKey();
+				}
+			}
+			remove(lru);
+		}
+	}
+
+	private synchronized void remove(String key) {
+		Entry old = this.entries.remove(key);
+		if(old != null) this.bytes -= old.weight;
+	}
+
+	private static class Entry
+	{
+
+		final String[] lines;
+
+		final long size;
+
+		final long modified;
+
+		final long weight;
+
+		volatile long used;
+
+		Entry(String[] lines, long size, long modified) {
+			this.lines = lines;
+			this.size = size;
+			this.modified = modified;
+			long w = 0;
+			for(int i = 0; i < lines.length; i++)
+				w += lines[i].length() + LINE_OVERHEAD;
+			this.weight = w;
+		}
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+import java.io.IOException;
+import java.io.Reader;
+import java.nio.ByteBuffer;
+import java.nio.CharBuffer;
+import java.nio.charset.CharsetDecoder;
+import java.nio.charset.CoderResult;
+import java.nio.charset.CodingErrorAction;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+
+public class LineBuffer
+{
+
+	private char[] data;
+
+	private int length;
+
+	// Line i spans [bounds[2i], bounds[2i + 1]) in data, terminator excluded.
+	private int[] bounds;
+
+	private int count;
+
+	private LineBuffer(char[] data, int length) {
+		this.data = data;
+		this.length = length;
+		this.bounds = new int[16];
+		index();
+	}
+
+	public static LineBuffer read(Reader r, long sizeHint) throws IOException {
+		char[] data = new char[(int)Math.min(Math.max(sizeHint, 16), Integer.MAX_VALUE - 8)];
+		int n = 0;
+		while(true) {
+			if(n == data.length) data = grow(data);
+			int got = r.read(data, n, data.length - n);
+			if(got < 0) break;
+			n += got;
+		}
+		return new LineBuffer(data, n);
+	}
+
+	// Decodes the mapping straight into the backing array, so the bytes
+	// are touched exactly once on their way from the page cache.
+	public static LineBuffer decode(MappedFile mf, Charset cs) throws IOException {
+		CharsetDecoder dec = cs.newDecoder()
+			.onMalformedInput(CodingErrorAction.REPLACE)
+			.onUnmappableCharacter(CodingErrorAction.REPLACE);
+		char[] data = new char[(int)Math.min(Math.max(mf.size(), 16), Integer.MAX_VALUE - 8)];
+		CharBuffer out = CharBuffer.wrap(data);
+		for(int i = 0; i < mf.segmentCount(); i++) {
+			ByteBuffer in = mf.segment(i).duplicate();
+			boolean last = (i == mf.segmentCount() - 1);
+			while(true) {
+				CoderResult cr = dec.decode(in, out, last);
+				if(!cr.isOverflow()) break;
+				out = regrow(out);
+			}
+		}
+		while(dec.flush(out).isOverflow())
+			out = regrow(out);
+		return new LineBuffer(out.array(), out.position());
+	}
+
+	private static char[] grow(char[] a) throws IOException {
+		if(a.length >= Integer.MAX_VALUE - 8)
+			throw new IOException("File too large for a LineBuffer");
+		int n = (int)Math.min((long)a.length * 2, Integer.MAX_VALUE - 8);
+		char[] b = new char[n];
+		System.arraycopy(a, 0, b, 0, a.length);
+		return b;
+	}
+
+	private static CharBuffer regrow(CharBuffer out) throws IOException {
+		CharBuffer b = CharBuffer.wrap(grow(out.array()));
+		b.position(out.position());
+		return b;
+	}
+
+	private void index() {
+		int start = 0;
+		int i = 0;
+		while(i < this.length) {
+			char c = this.data[i];
+			if(c == '\n' || c == '\r') {
+				add(start, i);
+				i += (c == '\r' && i + 1 < this.length && this.data[i + 1] == '\n') ? 2 : 1;
+				start = i;
+			} else {
+				i++;
+			}
+		}
+		if(start < this.length) add(start, this.length);
+	}
+
+	private void add(int start, int end) {
+		if(2 * this.count + 2 > this.bounds.length) {
+			int[] b = new int[this.bounds.length * 2];
+			System.arraycopy(this.bounds, 0, b, 0, this.bounds.length);
+			this.bounds = b;
+		}
+		this.bounds[2 * this.count] = start;
+		this.bounds[2 * this.count + 1] = end;
+		this.count++;
+	}
+
+	public int size() {
+		return this.count;
+	}
+
+	public int length(int line) {
+		return this.bounds[2 * line + 1] - this.bounds[2 * line];
+	}
+
+	public char charAt(int line, int index) {
+		return this.data[this.bounds[2 * line] + index];
+	}
+
+	public Line line(int i) {
+		return new Line(i);
+	}
+
+	public String toString(int line) {
+		return new String(this.data, this.bounds[2 * line], length(line));
+	}
+
+	public ArrayList<String> toList() {
+		ArrayList<String> l = new ArrayList<String>(this.count);
+		for(int i = 0; i < this.count; i++)
+			l.add(toString(i));
+		return l;
+	}
+
+	// A view over one line of the shared buffer. set() repoints it, so a
+	// single instance can walk every line without allocating.
+	public class Line implements CharSequence
+	{
+
+		private int start;
+
+		private int end;
+
+		private Line(int i) {
+			set(i);
+		}
+
+		public Line set(int i) {
+			if(i < 0 || i >= count) throw new IndexOutOfBoundsException("line " + i);
+			this.start = bounds[2 * i];
+			this.end = bounds[2 * i + 1];
+			return this;
+		}
+
+		public int length() {
+			return this.end - this.start;
+		}
+
+		public char charAt(int index) {
+			if(index < 0 || index >= length()) throw new IndexOutOfBoundsException("index " + index);
+			return data[this.start + index];
+		}
+
+		public CharSequence subSequence(int from, int to) {
+			if(from < 0 || to > length() || from > to) throw new IndexOutOfBoundsException(from + ", " + to);
+			return CharBuffer.wrap(data, this.start + from, to - from);
+		}
+
+		public String toString() {
+			return new String(data, this.start, length());
+		}
+
+	}
+
+}
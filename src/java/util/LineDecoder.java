@@ -0,0 +1,79 @@
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+import java.nio.charset.StandardCharsets;
+
+public class LineDecoder
+{
+
+	private Charset charset;
+
+	// Set when every ASCII byte decodes to the same char in charset, so
+	// pure-ASCII lines can skip the charset's decoder.
+	private boolean asciiFast;
+
+	private StringTable strings;
+
+	private byte[] scratch;
+
+	private ByteBuffer source;
+
+	private ByteBuffer view;
+
+	public LineDecoder(Charset cs) {
+		this(cs, null);
+	}
+
+	// With a table, every decoded line is interned in it.
+	public LineDecoder(Charset cs, StringTable strings) {
+		this.charset = cs;
+		this.strings = strings;
+		this.asciiFast = isAsciiSuperset(cs);
+		this.scratch = new byte[128];
+	}
+
+	public Charset charset() {
+		return this.charset;
+	}
+
+	boolean asciiFast() {
+		return this.asciiFast;
+	}
+
+	public static boolean isAsciiSuperset(Charset cs) {
+		String n = cs.name();
+		return n.equals("UTF-8") || n.equals("US-ASCII") || n.startsWith("ISO-8859-") || n.startsWith("windows-125");
+	}
+
+	public static boolean isAscii(ByteBuffer b, int off, int len) {
+		int i = off;
+		int end = off + len;
+		for(; i + 8 <= end; i += 8)
+			if((b.getLong(i) & 0x8080808080808080L) != 0) return false;
+		for(; i < end; i++)
+			if(b.get(i) < 0) return false;
+		return true;
+	}
+
+	public String decode(ByteBuffer b, int off, int len) {
+		if(this.strings != null) return this.strings.intern(b, off, len, this);
+		return newString(b, off, len);
+	}
+
+	String newString(ByteBuffer b, int off, int len) {
+		// Latin-1 decoding is a plain byte copy into the String.
+		Charset cs = (this.asciiFast && isAscii(b, off, len)) ? StandardCharsets.ISO_8859_1 : this.charset;
+		if(b.hasArray())
+			return new String(b.array(), b.arrayOffset() + off, len, cs);
+		if(len > this.scratch.length)
+			this.scratch = new byte[Math.max(len, this.scratch.length * 2)];
+		if(b != this.source) {
+			this.source = b;
+			this.view = b.duplicate();
+		}
+		this.view.limit(off + len);
+		this.view.position(off);
+		this.view.get(this.scratch, 0, len);
+		return new String(this.scratch, 0, len, cs);
+	}
+
+}
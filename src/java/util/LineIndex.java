@@ -0,0 +1,184 @@
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+
+// Byte offsets of every line start in a file. Line n spans
+// [start(n), start(n + 1)) including its terminator; the last entry is
+// the file size.
+public class LineIndex
+{
+
+	private static final int MAGIC = 0x50484c49;
+
+	private static final int VERSION = 1;
+
+	private long[] starts;
+
+	private int count;
+
+	private long size;
+
+	private long modified;
+
+	private LineIndex() {
+		this.starts = new long[64];
+	}
+
+	public static LineIndex build(File f) throws IOException {
+		return build(f, CancellationToken.NONE);
+	}
+
+	public static LineIndex build(File f, CancellationToken token) throws IOException {
+		LineIndex idx = new LineIndex();
+		idx.modified = f.lastModified();
+		FileInputStream in = new FileInputStream(f);
+		try {
+			idx.scan(in.getChannel(), token);
+		} finally {
+			in.close();
+		}
+		return idx;
+	}
+
+	private void scan(FileChannel ch, CancellationToken token) throws IOException {
+		ByteBuffer buf = BufferPool.acquire();
+		try {
+			scan(ch, token, buf);
+		} finally {
+			BufferPool.release(buf);
+		}
+	}
+
+	private void scan(FileChannel ch, CancellationToken token, ByteBuffer buf) throws IOException {
+		long base = 0;
+		boolean prevCR = false;
+		add(0);
+		while(true) {
+			token.throwIfCancelled();
+			buf.clear();
+			int lim = ch.read(buf);
+			if(lim < 0) break;
+			int i = 0;
+			if(prevCR && lim > 0) {
+				prevCR = false;
+				if(buf.get(0) == '\n') {
+					add(base + 1);
+					i = 1;
+				} else {
+					add(base);
+				}
+			}
+			while(i < lim) {
+				int eol = LineScanner.indexOfEol(buf, i, lim);
+				if(eol < 0) break;
+				if(buf.get(eol) == '\n') {
+					i = eol + 1;
+				} else if(eol + 1 == lim) {
+					prevCR = true;
+					i = lim;
+					continue;
+				} else {
+					i = LineScanner.skipEol(buf, eol, lim);
+				}
+				add(base + i);
+			}
+			base += lim;
+		}
+		if(prevCR) add(base);
+		this.size = base;
+		// A terminator at end of file does not start another line.
+		if(this.starts[this.count - 1] != this.size) add(this.size);
+		this.count--;
+	}
+
+	private void add(long start) {
+		if(this.count == this.starts.length) {
+			long[] s = new long[this.starts.length * 2];
+			System.arraycopy(this.starts, 0, s, 0, this.count);
+			this.starts = s;
+		}
+		this.starts[this.count++] = start;
+	}
+
+	public long lineCount() {
+		return this.count;
+	}
+
+	public long start(long line) {
+		return this.starts[(int)line];
+	}
+
+	public long end(long line) {
+		return this.starts[(int)line + 1];
+	}
+
+	public long size() {
+		return this.size;
+	}
+
+	public boolean isStale(File f) {
+		return f.length() != this.size || f.lastModified() != this.modified;
+	}
+
+	// Returns the line containing the given byte offset.
+	public long lineOf(long offset) {
+		int lo = 0;
+		int hi = this.count - 1;
+		while(lo < hi) {
+			int mid = (lo + hi + 1) >>> 1;
+			if(this.starts[mid] <= offset) lo = mid;
+			else hi = mid - 1;
+		}
+		return lo;
+	}
+
+	public static File sidecar(File f) {
+		return new File(f.getPath() + ".idx");
+	}
+
+	public void save(File out) throws IOException {
+		DataOutputStream dos = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(out)));
+		try {
+			dos.writeInt(MAGIC);
+			dos.writeInt(VERSION);
+			dos.writeLong(this.size);
+			dos.writeLong(this.modified);
+			dos.writeInt(this.count);
+			for(int i = 0; i <= this.count; i++)
+				dos.writeLong(this.starts[i]);
+		} finally {
+			dos.close();
+		}
+	}
+
+	// Loads a saved index, or returns null if it is missing, corrupt or
+	// no longer matches the size and mtime of f.
+	public static LineIndex load(File in, File f) throws IOException {
+		if(!in.exists()) return null;
+		DataInputStream dis = new DataInputStream(new BufferedInputStream(new FileInputStream(in)));
+		try {
+			if(dis.readInt() != MAGIC || dis.readInt() != VERSION) return null;
+			LineIndex idx = new LineIndex();
+			idx.size = dis.readLong();
+			idx.modified = dis.readLong();
+			if(idx.isStale(f)) return null;
+			int n = dis.readInt();
+			if(n < 0) return null;
+			idx.starts = new long[n + 1];
+			for(int i = 0; i <= n; i++)
+				idx.starts[i] = dis.readLong();
+			idx.count = n;
+			return idx;
+		} finally {
+			dis.close();
+		}
+	}
+
+}
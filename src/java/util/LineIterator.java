@@ -0,0 +1,71 @@
+import java.io.Closeable;
+import java.io.IOException;
+import java.io.UncheckedIOException;
+import java.util.Iterator;
+import java.util.NoSuchElementException;
+import java.util.Spliterator;
+import java.util.Spliterators;
+import java.util.stream.Stream;
+import java.util.stream.StreamSupport;
+
+public class LineIterator implements Iterator<String>, Closeable
+{
+
+	private LineSource source;
+
+	private String next;
+
+	private CancellationToken token;
+
+	private long count;
+
+	// A null source yields an empty iterator.
+	public LineIterator(LineSource src) {
+		this(src, CancellationToken.NONE);
+	}
+
+	public LineIterator(LineSource src, CancellationToken token) {
+		this.source = src;
+		this.token = token;
+	}
+
+	public boolean hasNext() {
+		if(this.next == null && this.source != null) {
+			if((++this.count & SFileStream.CHECK_MASK) == 0 && this.token.isCancelled()) {
+				close();
+				this.token.throwIfCancelled();
+			}
+			try {
+				this.next = this.source.readLine();
+			} catch(IOException ioe) {
+				close();
+				throw new UncheckedIOException(ioe);
+			}
+			if(this.next == null) close();
+		}
+		return this.next != null;
+	}
+
+	public String next() {
+		if(!hasNext()) throw new NoSuchElementException();
+		String s = this.next;
+		this.next = null;
+		return s;
+	}
+
+	public void close() {
+		if(this.source == null) return;
+		try {
+			this.source.close();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		this.source = null;
+	}
+
+	public Stream<String> stream() {
+		Spliterator<String> sp = Spliterators.spliteratorUnknownSize(this, Spliterator.ORDERED | Spliterator.NONNULL);
+		return StreamSupport.stream(sp, false).onClose(this::close);
+	}
+
+}
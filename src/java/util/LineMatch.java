@@ -0,0 +1,37 @@
+// A line that contained the pattern given to SFileStream.find: its text,
+// the offset of its first byte and, when asked for, its line number.
+public class LineMatch
+{
+
+	private long offset;
+
+	private long line;
+
+	private String text;
+
+	LineMatch(long offset, long line, String text) {
+		this.offset = offset;
+		this.line = line;
+		this.text = text;
+	}
+
+	// Into the decompressed text for a compressed file, and -1 when the
+	// charset forced a line-by-line search.
+	public long offset() {
+		return this.offset;
+	}
+
+	// Counted from 0, or -1 when no line numbers were asked for.
+	public long line() {
+		return this.line;
+	}
+
+	public String text() {
+		return this.text;
+	}
+
+	public String toString() {
+		return (this.line >= 0 ? this.line + ":" : "") + this.text;
+	}
+
+}
\ No newline at end of file
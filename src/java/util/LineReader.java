@@ -0,0 +1,116 @@
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.ReadableByteChannel;
+import java.nio.charset.Charset;
+
+// Splits lines on raw bytes read from a channel, so the number of bytes
+// consumed is always known. Only valid for charsets in which '\n' and
+// '\r' are single bytes that never occur inside other characters. The
+// buffer comes from BufferPool and goes back to it on close().
+public class LineReader implements LineSource
+{
+
+	public static final int DEFAULT_BUFFER_SIZE = BufferPool.DEFAULT_SIZE;
+
+	private ReadableByteChannel ch;
+
+	private ByteBuffer buf;
+
+	private int off;
+
+	private int end;
+
+	private long position;
+
+	private boolean eof;
+
+	// The previous line ended in '\r' at the end of the buffer, so a '\n'
+	// at the start of the next fill belongs to it.
+	private boolean skipLF;
+
+	private ByteLine line;
+
+	public LineReader(ReadableByteChannel ch, Charset cs) {
+		this(ch, cs, DEFAULT_BUFFER_SIZE);
+	}
+
+	public LineReader(ReadableByteChannel ch, Charset cs, int bufferSize) {
+		this.ch = ch;
+		this.buf = BufferPool.acquire(bufferSize);
+		this.line = new ByteLine(cs);
+	}
+
+	public long position() {
+		return this.position;
+	}
+
+	public String readLine() throws IOException {
+		return readLine(this.line) ? this.line.toString() : null;
+	}
+
+	public boolean readLine(ByteLine out) throws IOException {
+		while(true) {
+			if(this.skipLF) {
+				if(this.off == this.end && !this.eof) {
+					fill();
+					continue;
+				}
+				if(this.off < this.end && this.buf.get(this.off) == '\n')
+					consume(this.off + 1);
+				this.skipLF = false;
+			}
+			int eol = LineScanner.indexOfEol(this.buf, this.off, this.end);
+			if(eol >= 0) {
+				out.set(this.buf, this.off, eol - this.off);
+				if(this.buf.get(eol) == '\r' && eol + 1 == this.end) {
+					this.skipLF = true;
+					consume(eol + 1);
+				} else {
+					consume(LineScanner.skipEol(this.buf, eol, this.end));
+				}
+				return true;
+			}
+			if(this.eof) {
+				if(this.off == this.end) return false;
+				out.set(this.buf, this.off, this.end - this.off);
+				consume(this.end);
+				return true;
+			}
+			fill();
+		}
+	}
+
+	private void consume(int next) {
+		this.position += next - this.off;
+		this.off = next;
+	}
+
+	private void fill() throws IOException {
+		if(this.off == 0 && this.end == this.buf.capacity()) {
+			ByteBuffer b = BufferPool.acquire(this.buf.capacity() * 2);
+			this.buf.position(0);
+			this.buf.limit(this.end);
+			b.put(this.buf);
+			BufferPool.release(this.buf);
+			this.buf = b;
+		} else {
+			this.buf.position(this.off);
+			this.buf.limit(this.end);
+			this.buf.compact();
+		}
+		this.off = 0;
+		int n = this.ch.read(this.buf);
+		if(n < 0) this.eof = true;
+		this.end = this.buf.position();
+		this.buf.limit(this.buf.capacity());
+	}
+
+	public void close() throws IOException {
+		if(this.buf != null) {
+			BufferPool.release(this.buf);
+			this.buf = null;
+		}
+		this.ch.close();
+	}
+
+}
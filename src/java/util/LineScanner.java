@@ -0,0 +1,136 @@
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+import java.util.Arrays;
+import java.util.List;
+
+public class LineScanner
+{
+
+	// Below this many bytes the JNI transition costs more than the scan.
+	private static final int NATIVE_MIN = 64;
+
+	// True when line terminators can be found by scanning raw bytes.
+	public static boolean isAsciiCompatible(Charset cs) {
+		return cs.canEncode() && Arrays.equals("\r\nA".getBytes(cs), new byte[] { '\r', '\n', 'A' });
+	}
+
+	public static int indexOfEol(ByteBuffer b, int from, int to) {
+		return indexOfAny(b, (byte)'\n', (byte)'\r', from, to);
+	}
+
+	// Index of the first byte in [from, to) equal to x or y, or -1. Long
+	// ranges go to the vectorized kernel in the native runtime.
+	public static int indexOfAny(ByteBuffer b, byte x, byte y, int from, int to) {
+		if(to - from >= NATIVE_MIN && Native.isAvailable()) {
+			if(b.hasArray()) {
+				int base = b.arrayOffset();
+				int r = Native.findArray(b.array(), base + from, base + to, x, y);
+				return (r < 0) ? -1 : r - base;
+			}
+			if(b.isDirect())
+				return Native.findDirect(b, from, to, x, y);
+		}
+		for(int i = from; i < to; i++) {
+			byte c = b.get(i);
+			if(c == x || c == y) return i;
+		}
+		return -1;
+	}
+
+	// Stores the indexes of bytes in [from, to) equal to x or y into out
+	// and returns how many were found. A full out means the scan stopped
+	// early and should resume after the last index.
+	public static int scan(ByteBuffer b, int from, int to, byte x, byte y, int[] out) {
+		if(to - from >= NATIVE_MIN && Native.isAvailable()) {
+			if(b.hasArray()) {
+				int base = b.arrayOffset();
+				int n = Native.scanArray(b.array(), base + from, base + to, x, y, out);
+				if(base != 0)
+					for(int i = 0; i < n; i++) out[i] -= base;
+				return n;
+			}
+			if(b.isDirect())
+				return Native.scanDirect(b, from, to, x, y, out);
+		}
+		int n = 0;
+		for(int i = from; i < to && n < out.length; i++) {
+			byte c = b.get(i);
+			if(c == x || c == y) out[n++] = i;
+		}
+		return n;
+	}
+
+	public static int indexOf(ByteBuffer b, byte c, int from, int to) {
+		for(int i = from; i < to; i++)
+			if(b.get(i) == c) return i;
+		return -1;
+	}
+
+	// Index of the first occurrence of needle in [from, to), or -1. Long
+	// ranges go to the native substring kernel; the fallback looks for
+	// the first byte and then compares the rest.
+	public static int indexOf(ByteBuffer b, byte[] needle, int from, int to) {
+		int m = needle.length;
+		if(m == 0) return (from <= to) ? from : -1;
+		if(to - from >= NATIVE_MIN && Native.isAvailable()) {
+			if(b.hasArray()) {
+				int base = b.arrayOffset();
+				int r = Native.findBytesArray(b.array(), base + from, base + to, needle);
+				return (r < 0) ? -1 : r - base;
+			}
+			if(b.isDirect())
+				return Native.findBytesDirect(b, from, to, needle);
+		}
+		byte first = needle[0];
+		for(int i = from; i <= to - m; i++) {
+			if(b.get(i) != first) continue;
+			int k = 1;
+			while(k < m && b.get(i + k) == needle[k])
+				k++;
+			if(k == m) return i;
+		}
+		return -1;
+	}
+
+	// Index of the last '\n' or '\r' in [from, to), or -1.
+	public static int lastIndexOfEol(ByteBuffer b, int from, int to) {
+		for(int i = to - 1; i >= from; i--) {
+			byte c = b.get(i);
+			if(c == '\n' || c == '\r') return i;
+		}
+		return -1;
+	}
+
+	public static int lastIndexOf(ByteBuffer b, byte c, int from, int to) {
+		for(int i = to - 1; i >= from; i--)
+			if(b.get(i) == c) return i;
+		return -1;
+	}
+
+	// Returns the index just past the line terminator starting at eol,
+	// treating "\r\n" as one terminator the way BufferedReader does.
+	public static int skipEol(ByteBuffer b, int eol, int to) {
+		if(b.get(eol) == '\r' && eol + 1 < to && b.get(eol + 1) == '\n')
+			return eol + 2;
+		return eol + 1;
+	}
+
+	// Decodes every line in [from, to) into out, with the same terminator
+	// rules as BufferedReader.readLine().
+	public static void split(ByteBuffer b, int from, int to, LineDecoder dec, List<String> out) {
+		int[] eols = new int[512];
+		int i = from;
+		while(i < to) {
+			int n = scan(b, i, to, (byte)'\n', (byte)'\r', eols);
+			for(int k = 0; k < n; k++) {
+				// The '\n' of a "\r\n" pair was consumed with its '\r'.
+				if(eols[k] < i) continue;
+				out.add(dec.decode(b, i, eols[k] - i));
+				i = skipEol(b, eols[k], to);
+			}
+			if(n < eols.length) break;
+		}
+		if(i < to) out.add(dec.decode(b, i, to - i));
+	}
+
+}
@@ -0,0 +1,17 @@
+import java.io.Closeable;
+import java.io.IOException;
+
+public interface LineSource extends Closeable
+{
+
+	// Returns the next line without its terminator, or null at end of input.
+	public String readLine() throws IOException;
+
+	// Points out at the next line's bytes without decoding them. Returns
+	// false at end of input.
+	public boolean readLine(ByteLine out) throws IOException;
+
+	// Bytes consumed so far, or -1 when the source cannot tell.
+	public long position();
+
+}
@@ -0,0 +1,8 @@
+public interface LineVisitor
+{
+
+	// Called once per line; returning false stops the scan. The line is
+	// only valid for the duration of the call.
+	public boolean visit(ByteLine line);
+
+}
@@ -0,0 +1,93 @@
+import java.io.Closeable;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.CharBuffer;
+import java.nio.channels.WritableByteChannel;
+import java.nio.charset.Charset;
+import java.nio.charset.CharsetEncoder;
+import java.nio.charset.CoderResult;
+import java.nio.charset.CodingErrorAction;
+
+// Encodes text straight into a pooled direct buffer and writes it to a
+// channel each time the buffer fills, in place of a BufferedWriter with
+// its own char and byte buffers. Characters the charset cannot encode
+// are replaced, as String.getBytes does.
+public class LineWriter implements Closeable
+{
+
+	private WritableByteChannel ch;
+
+	private CharsetEncoder enc;
+
+	private ByteBuffer buf;
+
+	private long written;
+
+	public LineWriter(WritableByteChannel ch, Charset cs) {
+		this(ch, cs, BufferPool.DEFAULT_SIZE);
+	}
+
+	public LineWriter(WritableByteChannel ch, Charset cs, int bufferSize) {
+		this.ch = ch;
+		this.enc = cs.newEncoder().onMalformedInput(CodingErrorAction.REPLACE).onUnmappableCharacter(CodingErrorAction.REPLACE);
+		this.buf = BufferPool.acquire(bufferSize);
+	}
+
+	// Bytes handed to the channel so far.
+	public long written() {
+		return this.written;
+	}
+
+	// Each call is encoded on its own, so a surrogate pair split across
+	// two calls is replaced rather than joined.
+	public void write(CharSequence s) throws IOException {
+		this.enc.reset();
+		encode(CharBuffer.wrap(s), true);
+	}
+
+	// s and then a '\n', encoded as one piece.
+	public void writeLine(CharSequence s) throws IOException {
+		this.enc.reset();
+		CharBuffer in = CharBuffer.wrap(s);
+		encode(in, false);
+		// Only a high surrogate at the very end can be left over; it goes
+		// in with the '\n' so it is replaced rather than dropped.
+		encode(CharBuffer.wrap(in.hasRemaining() ? in.toString() + "\n" : "\n"), true);
+	}
+
+	private void encode(CharBuffer in, boolean last) throws IOException {
+		while(true) {
+			CoderResult r = this.enc.encode(in, this.buf, last);
+			if(r.isUnderflow()) break;
+			if(r.isOverflow()) drain();
+			else r.throwException();
+		}
+		if(last)
+			while(this.enc.flush(this.buf).isOverflow())
+				drain();
+	}
+
+	public void flush() throws IOException {
+		drain();
+	}
+
+	private void drain() throws IOException {
+		this.buf.flip();
+		while(this.buf.hasRemaining())
+			this.written += this.ch.write(this.buf);
+		this.buf.clear();
+	}
+
+	// Flushes, closes the channel and returns the buffer to the pool.
+	public void close() throws IOException {
+		if(this.buf == null) return;
+		try {
+			drain();
+		} finally {
+			BufferPool.release(this.buf);
+			this.buf = null;
+			this.ch.close();
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+
+public class MappedFile
+{
+
+	// A single MappedByteBuffer is limited to 2 GB, so larger files are
+	// mapped as several segments, each cut just after a '\n' so that no
+	// line spans two segments.
+	private static final long MAX_SEGMENT = Integer.MAX_VALUE;
+
+	private MappedByteBuffer[] segments;
+
+	private long[] starts;
+
+	private long size;
+
+	private long modified;
+
+	private MappedFile(MappedByteBuffer[] segments, long[] starts, long size, long modified) {
+		this.segments = segments;
+		this.starts = starts;
+		this.size = size;
+		this.modified = modified;
+	}
+
+	public static MappedFile map(File f) throws IOException {
+		RandomAccessFile raf = new RandomAccessFile(f, "r");
+		try {
+			FileChannel ch = raf.getChannel();
+			long size = ch.size();
+			ArrayList<MappedByteBuffer> segs = new ArrayList<MappedByteBuffer>();
+			ArrayList<Long> starts = new ArrayList<Long>();
+			long pos = 0;
+			while(pos < size) {
+				long len = Math.min(MAX_SEGMENT, size - pos);
+				MappedByteBuffer mb = ch.map(FileChannel.MapMode.READ_ONLY, pos, len);
+				if(pos + len < size) {
+					int cut = LineScanner.lastIndexOf(mb, (byte)'\n', 0, (int)len);
+					if(cut < 0)
+						throw new IOException("Line longer than " + MAX_SEGMENT + " bytes in " + f);
+					len = cut + 1;
+					mb.limit((int)len);
+				}
+				segs.add(mb);
+				starts.add(pos);
+				pos += len;
+			}
+			long[] st = new long[starts.size()];
+			for(int i = 0; i < st.length; i++)
+				st[i] = starts.get(i);
+			return new MappedFile(segs.toArray(new MappedByteBuffer[0]), st, size, f.lastModified());
+		} finally {
+			raf.close();
+		}
+	}
+
+	public long size() {
+		return this.size;
+	}
+
+	// True when the file no longer matches what was mapped and the
+	// mapping should be replaced before it is read again.
+	public boolean isStale(File f) {
+		return f.length() != this.size || f.lastModified() != this.modified;
+	}
+
+	public int segmentCount() {
+		return this.segments.length;
+	}
+
+	public ByteBuffer segment(int i) {
+		return this.segments[i];
+	}
+
+	public long segmentStart(int i) {
+		return this.starts[i];
+	}
+
+	public Cursor cursor(Charset cs) {
+		return new Cursor(cs);
+	}
+
+	public class Cursor implements LineSource
+	{
+
+		private ByteLine line;
+
+		private int seg;
+
+		private int off;
+
+		private Cursor(Charset cs) {
+			this.line = new ByteLine(cs);
+		}
+
+		public long position() {
+			if(this.seg >= segments.length) return size;
+			return starts[this.seg] + this.off;
+		}
+
+		public String readLine() {
+			return readLine(this.line) ? this.line.toString() : null;
+		}
+
+		public boolean readLine(ByteLine out) {
+			while(this.seg < segments.length) {
+				ByteBuffer b = segments[this.seg];
+				int lim = b.limit();
+				if(this.off < lim) {
+					int eol = LineScanner.indexOfEol(b, this.off, lim);
+					int end = (eol < 0) ? lim : eol;
+					out.set(b, this.off, end - this.off);
+					this.off = (eol < 0) ? lim : LineScanner.skipEol(b, eol, lim);
+					return true;
+				}
+				this.seg++;
+				this.off = 0;
+			}
+			return false;
+		}
+
+		// The mapping outlives its cursors, so there is nothing to release.
+		public void close() {
+		}
+
+	}
+
+}
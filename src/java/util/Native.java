@@ -0,0 +1,124 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+// Bindings to the C++ runtime (libphoton.so, built from src/runtime).
+// Every caller must check isAvailable() and keep a pure Java path, since
+// the library is optional. It is looked up at -Dphoton.library, then on
+// java.library.path, then next to these classes and one directory up.
+public class Native
+{
+
+	private static final boolean AVAILABLE = load();
+
+	private static boolean load() {
+		String lib = System.mapLibraryName("photon");
+		try {
+			String path = System.getProperty("photon.library");
+			if(path != null) {
+				System.load(new File(path).getAbsolutePath());
+				return true;
+			}
+		} catch(UnsatisfiedLinkError | SecurityException e) {
+			return false;
+		}
+		try {
+			System.loadLibrary("photon");
+			return true;
+		} catch(UnsatisfiedLinkError | SecurityException e) {
+		}
+		try {
+			File dir = new File(Native.class.getProtectionDomain().getCodeSource().getLocation().toURI());
+			for(int i = 0; i < 2 && dir != null; i++, dir = dir.getParentFile()) {
+				File f = new File(dir, lib);
+				if(f.isFile()) {
+					System.load(f.getAbsolutePath());
+					return true;
+				}
+			}
+		} catch(Exception | UnsatisfiedLinkError e) {
+		}
+		return false;
+	}
+
+	public static boolean isAvailable() {
+		return AVAILABLE;
+	}
+
+	public static String scanKernel() {
+		return AVAILABLE ? nativeScanKernel() : "java";
+	}
+
+	private static native String nativeScanKernel();
+
+	// Index of the first byte in [from, to) equal to a or b, or -1.
+	static native int findDirect(ByteBuffer buf, int from, int to, byte a, byte b);
+
+	static native int findArray(byte[] arr, int from, int to, byte a, byte b);
+
+	// Stores the indexes of bytes in [from, to) equal to a or b into out
+	// and returns how many were found; out.length means "resume after the
+	// last one".
+	static native int scanDirect(ByteBuffer buf, int from, int to, byte a, byte b, int[] out);
+
+	static native int scanArray(byte[] arr, int from, int to, byte a, byte b, int[] out);
+
+	// Index of the first occurrence of needle in [from, to), or -1.
+	static native int findBytesDirect(ByteBuffer buf, int from, int to, byte[] needle);
+
+	static native int findBytesArray(byte[] arr, int from, int to, byte[] needle);
+
+	// IoRing handles. ringWait blocks and fills out with (id, result)
+	// pairs, where result is a byte count or -errno.
+	static native long ringOpen(int entries);
+
+	static native void ringClose(long ring);
+
+	static native boolean ringIsUring(long ring);
+
+	static native int ringReadFile(long ring, String path, ByteBuffer buf, long len, long id);
+
+	static native void ringReadFiles(long ring, String[] paths, ByteBuffer[] bufs, long[] lens, long[] ids, int[] results);
+
+	static native int ringWait(long ring, long[] out);
+
+	static native void ringWake(long ring);
+
+	// Queues a read of an open NativeFile handle; it completes like the
+	// reads above.
+	static native void ringRead(long ring, long file, ByteBuffer buf, int pos, int len, long off, long id);
+
+	// Files for positioned I/O, with flags from NativeFile. fileRead and
+	// fileWrite transfer [pos, pos + len) of a direct buffer; a read
+	// returns fewer than len bytes only at end of file.
+	static native long fileOpen(String path, int flags) throws IOException;
+
+	static native void fileClose(long file);
+
+	static native boolean fileIsDirect(long file);
+
+	static native int fileRead(long file, ByteBuffer buf, int pos, int len, long off) throws IOException;
+
+	static native int fileWrite(long file, ByteBuffer buf, int pos, int len, long off) throws IOException;
+
+	static native long fileSize(long file) throws IOException;
+
+	static native void fileTruncate(long file, long size) throws IOException;
+
+	static native void fileSync(long file) throws IOException;
+
+	// Whole-file copy inside the kernel; bytes copied or -errno.
+	static native long copyFile(String src, String dst, boolean append);
+
+	// Streaming zstd decoding; available only when the runtime was built
+	// with libzstd. zstdDecompress stores the bytes consumed and produced
+	// in counts and returns 1 at the end of a frame.
+	static native boolean zstdAvailable();
+
+	static native long zstdOpen();
+
+	static native void zstdClose(long handle);
+
+	static native int zstdDecompress(long handle, ByteBuffer src, int srcPos, int srcLimit, ByteBuffer dst, int dstPos, int dstLimit, int[] counts) throws IOException;
+
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.ClosedChannelException;
+import java.nio.channels.SeekableByteChannel;
+import java.util.concurrent.CompletableFuture;
+
+// A file opened through the runtime's File: pread/pwrite on a plain
+// descriptor, optionally with O_DIRECT so large reads and writes bypass
+// the page cache. SFileStream reads and writes through it whenever the
+// runtime is loaded, unless -Dphoton.nativeio=false. Direct buffers go
+// straight to the kernel; heap buffers are copied through a pooled one.
+public class NativeFile implements SeekableByteChannel
+{
+
+	public static final int READ = 1;
+
+	public static final int WRITE = 2;
+
+	public static final int CREATE = 4;
+
+	public static final int TRUNCATE = 8;
+
+	// Falls back to buffered I/O where the file system refuses O_DIRECT.
+	public static final int DIRECT = 32;
+
+	public static final boolean ENABLED = Native.isAvailable() && !"false".equals(System.getProperty("photon.nativeio"));
+
+	// Matches File::ALIGN in the runtime.
+	private static final int ALIGN = 4096;
+
+	private static final int BOUNCE = 1 << 20;
+
+	private File file;
+
+	private volatile long handle;
+
+	private long position;
+
+	private NativeFile(File file, long handle) {
+		this.file = file;
+		this.handle = handle;
+	}
+
+	public static NativeFile open(File f, int flags) throws IOException {
+		if(!Native.isAvailable()) throw new IOException("NativeFile needs the native runtime");
+		return new NativeFile(f, Native.fileOpen(f.getPath(), flags));
+	}
+
+	public File file() {
+		return this.file;
+	}
+
+	// False when DIRECT was asked for but the file system does not allow it.
+	public boolean isDirect() throws IOException {
+		return Native.fileIsDirect(handle());
+	}
+
+	private long handle() throws IOException {
+		long h = this.handle;
+		if(h == 0) throw new ClosedChannelException();
+		return h;
+	}
+
+	// Reads into dst at off without moving this channel's position; -1 at
+	// end of file. Safe to call from several threads at once.
+	public int read(ByteBuffer dst, long off) throws IOException {
+		long h = handle();
+		int want = dst.remaining();
+		if(want == 0) return 0;
+		int n = 0;
+		if(dst.isDirect()) {
+			n = Native.fileRead(h, dst, dst.position(), want, off);
+			dst.position(dst.position() + n);
+		} else {
+			ByteBuffer b = BufferPool.acquire(Math.min(want, BOUNCE));
+			try {
+				while(n < want) {
+					int len = Math.min(want - n, b.capacity());
+					int r = Native.fileRead(h, b, 0, len, off + n);
+					b.clear().limit(r);
+					dst.put(b);
+					n += r;
+					if(r < len) break;
+				}
+			} finally {
+				BufferPool.release(b);
+			}
+		}
+		return (n == 0) ? -1 : n;
+	}
+
+	// Writes all of src at off without moving this channel's position.
+	public int write(ByteBuffer src, long off) throws IOException {
+		long h = handle();
+		int want = src.remaining();
+		if(want == 0) return 0;
+		if(src.isDirect()) {
+			Native.fileWrite(h, src, src.position(), want, off);
+			src.position(src.position() + want);
+			return want;
+		}
+		ByteBuffer b = BufferPool.acquire(Math.min(want, BOUNCE));
+		try {
+			int n = 0;
+			while(n < want) {
+				int len = Math.min(want - n, b.capacity());
+				ByteBuffer part = src.duplicate();
+				part.limit(part.position() + len);
+				b.clear();
+				b.put(part);
+				Native.fileWrite(h, b, 0, len, off + n);
+				src.position(src.position() + len);
+				n += len;
+			}
+		} finally {
+			BufferPool.release(b);
+		}
+		return want;
+	}
+
+	// Queues the read on the shared NativeRing; dst must be direct. The
+	// future gets the bytes read, 0 at end of file, and dst's position
+	// moves past them. O_DIRECT reads that are not block-aligned are
+	// done in the calling thread instead.
+	public CompletableFuture<Integer> readAsync(ByteBuffer dst, long off) {
+		if(!dst.isDirect()) throw new IllegalArgumentException("readAsync needs a direct buffer");
+		NativeRing ring = NativeRing.shared();
+		try {
+			boolean aligned = off % ALIGN == 0 && dst.remaining() % ALIGN == 0 && dst.alignmentOffset(dst.position(), ALIGN) == 0;
+			if(ring == null || (!aligned && isDirect()))
+				return CompletableFuture.completedFuture(Math.max(read(dst, off), 0));
+			return ring.read(handle(), dst, off);
+		} catch(IOException ioe) {
+			CompletableFuture<Integer> cf = new CompletableFuture<Integer>();
+			cf.completeExceptionally(ioe);
+			return cf;
+		}
+	}
+
+	public int read(ByteBuffer dst) throws IOException {
+		int n = read(dst, this.position);
+		if(n > 0) this.position += n;
+		return n;
+	}
+
+	public int write(ByteBuffer src) throws IOException {
+		int n = write(src, this.position);
+		this.position += n;
+		return n;
+	}
+
+	public long position() throws IOException {
+		handle();
+		return this.position;
+	}
+
+	public NativeFile position(long p) throws IOException {
+		if(p < 0) throw new IllegalArgumentException("Negative position: " + p);
+		handle();
+		this.position = p;
+		return this;
+	}
+
+	public long size() throws IOException {
+		return Native.fileSize(handle());
+	}
+
+	public NativeFile truncate(long size) throws IOException {
+		if(size < size()) Native.fileTruncate(handle(), size);
+		this.position = Math.min(this.position, size);
+		return this;
+	}
+
+	public void sync() throws IOException {
+		Native.fileSync(handle());
+	}
+
+	public boolean isOpen() {
+		return this.handle != 0;
+	}
+
+	// Reads in flight must have completed first.
+	public void close() {
+		long h;
+		synchronized(this) {
+			h = this.handle;
+			this.handle = 0;
+		}
+		if(h != 0) Native.fileClose(h);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
+
+// Java side of the runtime's IoRing. Reads are submitted from any thread
+// and completed by a single reaper thread, so hundreds of reads can be in
+// flight without a thread each.
+public class NativeRing
+{
+
+	private static final int ENTRIES = 256;
+
+	private static NativeRing shared;
+
+	private long handle;
+
+	private ConcurrentHashMap<Long, Pending> pending = new ConcurrentHashMap<Long, Pending>();
+
+	// Id 0 is how the runtime reports a wake-up.
+	private AtomicLong ids = new AtomicLong(1);
+
+	private Thread reaper;
+
+	private Runnable drain;
+
+	private volatile boolean closed;
+
+	private final ReentrantReadWriteLock lock = new ReentrantReadWriteLock();
+
+	private NativeRing() {
+		this.handle = Native.ringOpen(ENTRIES);
+		this.reaper = new Thread(this::reap, "photon-ring");
+		this.reaper.setDaemon(true);
+		this.reaper.start();
+		this.drain = this::close;
+		Global.onEnd(this.drain);
+	}
+
+	// The process-wide ring, or null when the runtime is not loaded.
+	public static synchronized NativeRing shared() {
+		if(!Native.isAvailable()) return null;
+		if(shared == null || shared.closed) shared = new NativeRing();
+		return shared;
+	}
+
+	public boolean isUring() {
+		return Native.ringIsUring(this.handle);
+	}
+
+	// Reads the whole file into a new direct buffer, flipped for reading.
+	// The buffer is the caller's and is freed by the garbage collector.
+	public CompletableFuture<ByteBuffer> readFile(File f) {
+		return readFile(f, false);
+	}
+
+	// With pooled set the buffer comes from BufferPool instead, and the
+	// caller releases it once it is done with the bytes.
+	CompletableFuture<ByteBuffer> readFile(File f, boolean pooled) {
+		CompletableFuture<ByteBuffer> cf = new CompletableFuture<ByteBuffer>();
+		long size = f.length();
+		if(size > Integer.MAX_VALUE - 8) {
+			cf.completeExceptionally(new IOException("File too large for an async read: " + f));
+			return cf;
+		}
+		this.lock.readLock().lock();
+		try {
+			if(this.closed) {
+				cf.completeExceptionally(new IOException("NativeRing is closed"));
+				return cf;
+			}
+			long id = this.ids.getAndIncrement();
+			ByteBuffer buf = buffer((int)size, pooled);
+			// Registered first: the completion can arrive before submit returns.
+			this.pending.put(id, new Pending(buf, cf));
+			int r = Native.ringReadFile(this.handle, f.getPath(), buf, size, id);
+			if(r < 0) {
+				this.pending.remove(id);
+				cf.completeExceptionally(new IOException("Cannot open " + f + " (errno " + -r + ")"));
+			}
+		} finally {
+			this.lock.readLock().unlock();
+		}
+		return cf;
+	}
+
+	// Reads every file like readFile, handing them to the runtime in one
+	// call so io_uring can take the whole batch in a single submission.
+	public List<CompletableFuture<ByteBuffer>> readFiles(List<File> files) {
+		return readFiles(files, false);
+	}
+
+	List<CompletableFuture<ByteBuffer>> readFiles(List<File> files, boolean pooled) {
+		int n = files.size();
+		ArrayList<CompletableFuture<ByteBuffer>> out = new ArrayList<CompletableFuture<ByteBuffer>>(n);
+		String[] paths = new String[n];
+		ByteBuffer[] bufs = new ByteBuffer[n];
+		long[] lens = new long[n];
+		long[] keys = new long[n];
+		int[] slots = new int[n];
+		int k = 0;
+		this.lock.readLock().lock();
+		try {
+			for(int i = 0; i < n; i++) {
+				File f = files.get(i);
+				CompletableFuture<ByteBuffer> cf = new CompletableFuture<ByteBuffer>();
+				out.add(cf);
+				long size = f.length();
+				if(size > Integer.MAX_VALUE - 8) {
+					cf.completeExceptionally(new IOException("File too large for an async read: " + f));
+				} else if(this.closed) {
+					cf.completeExceptionally(new IOException("NativeRing is closed"));
+				} else {
+					long id = this.ids.getAndIncrement();
+					ByteBuffer buf = buffer((int)size, pooled);
+					this.pending.put(id, new Pending(buf, cf));
+					paths[k] = f.getPath();
+					bufs[k] = buf;
+					lens[k] = size;
+					keys[k] = id;
+					slots[k++] = i;
+				}
+			}
+			if(k == 0) return out;
+			int[] res = new int[k];
+			Native.ringReadFiles(this.handle, Arrays.copyOf(paths, k), Arrays.copyOf(bufs, k), Arrays.copyOf(lens, k),
+				Arrays.copyOf(keys, k), res);
+			for(int j = 0; j < k; j++) {
+				if(res[j] >= 0) continue;
+				this.pending.remove(keys[j]);
+				out.get(slots[j]).completeExceptionally(new IOException("Cannot open " + files.get(slots[j]) + " (errno " + -res[j] + ")"));
+			}
+		} finally {
+			this.lock.readLock().unlock();
+		}
+		return out;
+	}
+
+	private static ByteBuffer buffer(int size, boolean pooled) {
+		return pooled ? BufferPool.acquire(size) : ByteBuffer.allocateDirect(size);
+	}
+
+	// A positioned read of an open file into dst; see NativeFile.readAsync.
+	CompletableFuture<Integer> read(long file, ByteBuffer dst, long off) {
+		CompletableFuture<ByteBuffer> cf = new CompletableFuture<ByteBuffer>();
+		this.lock.readLock().lock();
+		try {
+			if(this.closed) {
+				cf.completeExceptionally(new IOException("NativeRing is closed"));
+			} else {
+				long id = this.ids.getAndIncrement();
+				ByteBuffer part = dst.slice();
+				this.pending.put(id, new Pending(part, cf));
+				Native.ringRead(this.handle, file, part, 0, part.remaining(), off, id);
+			}
+		} finally {
+			this.lock.readLock().unlock();
+		}
+		return cf.thenApply(b -> {
+			dst.position(dst.position() + b.limit());
+			return b.limit();
+		});
+	}
+
+	private void reap() {
+		long[] out = new long[128];
+		while(!this.closed || !this.pending.isEmpty()) {
+			int n = Native.ringWait(this.handle, out);
+			for(int i = 0; i < n; i++) {
+				Pending p = this.pending.remove(out[2 * i]);
+				if(p == null) continue;
+				long res = out[2 * i + 1];
+				if(res < 0) {
+					p.cf.completeExceptionally(new IOException("Read failed (errno " + -res + ")"));
+				} else {
+					p.buf.limit((int)res);
+					p.cf.complete(p.buf);
+				}
+			}
+		}
+	}
+
+	// Waits for reads in flight, then releases the ring. Submits hold the
+	// read lock from their closed check until the runtime has the read, so
+	// once closed is set under the write lock every read the reaper must
+	// wait for is already in pending.
+	public void close() {
+		this.lock.writeLock().lock();
+		try {
+			if(this.closed) return;
+			this.closed = true;
+		} finally {
+			this.lock.writeLock().unlock();
+		}
+		Global.removeOnEnd(this.drain);
+		Native.ringWake(this.handle);
+		boolean interrupted = false;
+		while(true) {
+			try {
+				this.reaper.join();
+				break;
+			} catch(InterruptedException ie) {
+				interrupted = true;
+			}
+		}
+		Native.ringClose(this.handle);
+		if(interrupted) Thread.currentThread().interrupt();
+	}
+
+	private static class Pending
+	{
+
+		final ByteBuffer buf;
+
+		final CompletableFuture<ByteBuffer> cf;
+
+		Pending(ByteBuffer buf, CompletableFuture<ByteBuffer> cf) {
+			this.buf = buf;
+			this.cf = cf;
+		}
+
+	}
+
+}
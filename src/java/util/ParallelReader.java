@@ -0,0 +1,135 @@
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Future;
+
+// Splits a file into byte ranges ending just after a '\n' and decodes
+// each range as an independent task. Results come back in file order.
+public class ParallelReader
+{
+
+	private static final long MIN_CHUNK = 1L << 20;
+
+	private static final long MAX_CHUNK = 64L << 20;
+
+	public static List<List<String>> read(File f, Charset cs, ExecutorService pool, int parallelism, CancellationToken token) throws IOException {
+		return read(f, cs, null, pool, parallelism, token);
+	}
+
+	// Lines are interned in strings when it is not null.
+	public static List<List<String>> read(File f, Charset cs, StringTable strings, ExecutorService pool, int parallelism,
+			CancellationToken token) throws IOException {
+		FileInputStream in = new FileInputStream(f);
+		try {
+			FileChannel ch = in.getChannel();
+			long[] bounds = split(ch, ch.size(), parallelism);
+			ArrayList<Future<List<String>>> parts = new ArrayList<Future<List<String>>>();
+			for(int i = 0; i + 1 < bounds.length; i++)
+				parts.add(pool.submit(new Chunk(ch, cs, strings, bounds[i], bounds[i + 1], token)));
+			ArrayList<List<String>> out = new ArrayList<List<String>>(parts.size());
+			try {
+				for(int i = 0; i < parts.size(); i++)
+					out.add(join(parts.get(i)));
+			} catch(IOException | RuntimeException e) {
+				for(int i = 0; i < parts.size(); i++)
+					parts.get(i).cancel(false);
+				throw e;
+			}
+			return out;
+		} finally {
+			in.close();
+		}
+	}
+
+	private static <T> T join(Future<T> fut) throws IOException {
+		try {
+			return fut.get();
+		} catch(InterruptedException ie) {
+			Thread.currentThread().interrupt();
+			throw new IOException("Interrupted while reading", ie);
+		} catch(ExecutionException ee) {
+			if(ee.getCause() instanceof IOException) throw (IOException)ee.getCause();
+			if(ee.getCause() instanceof RuntimeException) throw (RuntimeException)ee.getCause();
+			throw new IOException(ee.getCause());
+		}
+	}
+
+	// Chunk boundaries, starting with 0 and ending with size. Every inner
+	// boundary sits just past a '\n', so no line or "\r\n" pair is split.
+	static long[] split(FileChannel ch, long size, int parallelism) throws IOException {
+		long chunks = Math.max((long)parallelism * 4, (size + MAX_CHUNK - 1) / MAX_CHUNK);
+		long chunk = Math.min(Math.max(size / Math.max(chunks, 1), MIN_CHUNK), MAX_CHUNK);
+		ArrayList<Long> b = new ArrayList<Long>();
+		b.add(0L);
+		ByteBuffer probe = ByteBuffer.allocate(1 << 12);
+		long pos = chunk;
+		while(pos < size) {
+			long cut = nextLineStart(ch, probe, pos, size);
+			if(cut >= size) break;
+			b.add(cut);
+			pos = cut + chunk;
+		}
+		b.add(size);
+		long[] out = new long[b.size()];
+		for(int i = 0; i < out.length; i++)
+			out[i] = b.get(i);
+		return out;
+	}
+
+	private static long nextLineStart(FileChannel ch, ByteBuffer probe, long pos, long size) throws IOException {
+		while(pos < size) {
+			probe.clear();
+			int n = ch.read(probe, pos);
+			if(n <= 0) break;
+			int eol = LineScanner.indexOf(probe, (byte)'\n', 0, n);
+			if(eol >= 0) return pos + eol + 1;
+			pos += n;
+		}
+		return size;
+	}
+
+	private static class Chunk implements Callable<List<String>>
+	{
+
+		private FileChannel ch;
+
+		private Charset cs;
+
+		private StringTable strings;
+
+		private long start;
+
+		private long end;
+
+		private CancellationToken token;
+
+		Chunk(FileChannel ch, Charset cs, StringTable strings, long start, long end, CancellationToken token) {
+			this.ch = ch;
+			this.cs = cs;
+			this.strings = strings;
+			this.start = start;
+			this.end = end;
+			this.token = token;
+		}
+
+		public List<String> call() throws IOException {
+			this.token.throwIfCancelled();
+			ByteBuffer buf = ByteBuffer.allocate((int)(this.end - this.start));
+			while(buf.hasRemaining())
+				if(this.ch.read(buf, this.start + buf.position()) < 0) break;
+			ArrayList<String> lines = new ArrayList<String>();
+			LineScanner.split(buf, 0, buf.position(), new LineDecoder(this.cs, this.strings), lines);
+			return lines;
+		}
+
+	}
+
+}
@@ -0,0 +1,377 @@
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.function.Function;
+import java.util.function.Predicate;
+
+// Streams the lines of one file through transforms into another. Every
+// stage is a task on the Scheduler and hands batches of lines to the next
+// one through an SpscRing. A stage runs while it can make progress. When
+// its input is empty or its output is full it returns its worker, and
+// the neighbour that changes that schedules it again, in the same way
+// the AsyncWriter drain task is scheduled. At most capacity batches wait
+// between two stages, so memory stays bounded however large the file is.
+// Global.endProgram() stops the source and waits until every line read
+// so far has been written.
+public class Pipeline
+{
+
+	public static final int DEFAULT_BATCH = 4096;
+
+	public static final int DEFAULT_CAPACITY = 16;
+
+	// Batches a stage moves before it yields its worker to other tasks.
+	private static final int ROUNDS = 64;
+
+	private SFileStream source;
+
+	private ArrayList<Function<List<String>, List<String>>> transforms = new ArrayList<Function<List<String>, List<String>>>();
+
+	private int batch = DEFAULT_BATCH;
+
+	private int capacity = DEFAULT_CAPACITY;
+
+	public Pipeline(SFileStream source) {
+		this.source = source;
+	}
+
+	// Lines per batch handed between stages.
+	public Pipeline withBatch(int lines) {
+		if(lines < 1) throw new IllegalArgumentException("Batch must hold at least one line");
+		this.batch = lines;
+		return this;
+	}
+
+	// Batches that may wait between two stages.
+	public Pipeline withCapacity(int batches) {
+		this.capacity = batches;
+		return this;
+	}
+
+	// A stage that replaces each line with f's result; null drops it.
+	public Pipeline map(Function<String, String> f) {
+		return transform(in -> {
+			ArrayList<String> out = new ArrayList<String>(in.size());
+			for(int i = 0; i < in.size(); i++) {
+				String s = f.apply(in.get(i));
+				if(s != null) out.add(s);
+			}
+			return out;
+		});
+	}
+
+	public Pipeline filter(Predicate<String> p) {
+		return map(s -> p.test(s) ? s : null);
+	}
+
+	// A stage that replaces each batch with f's result, which may be the
+	// same list changed in place. Batches arrive in file order.
+	public Pipeline transform(Function<List<String>, List<String>> f) {
+		this.transforms.add(f);
+		return this;
+	}
+
+	// Starts every stage and returns at once. Each line is written with a
+	// '\n' after it. The future gets the number of lines written and fails
+	// if a stage threw or the file could not be opened. If the source's
+	// token was cancelled or the program ended, it fails with
+	// CancellationException once the lines already read have been written.
+	public CompletableFuture<Long> to(SFileStream sink) {
+		CompletableFuture<Long> cf = new CompletableFuture<Long>();
+		LineSource in;
+		LineWriter out;
+		try {
+			in = this.source.openSource();
+		} catch(IOException ioe) {
+			cf.completeExceptionally(ioe);
+			return cf;
+		}
+		try {
+			out = new LineWriter(sink.openWrite(), sink.charset());
+		} catch(IOException ioe) {
+			try {
+				in.close();
+			} catch(IOException e) {
+				e.printStackTrace();
+			}
+			cf.completeExceptionally(ioe);
+			return cf;
+		}
+		new Run(in, out, cf).start();
+		return cf;
+	}
+
+	private class Run
+	{
+
+		private Stage[] stages;
+
+		private AtomicInteger live;
+
+		private CompletableFuture<Long> done;
+
+		private volatile Throwable error;
+
+		private volatile boolean stopped;
+
+		private volatile long written;
+
+		private int lines = batch;
+
+		private Runnable drain;
+
+		Run(LineSource in, LineWriter out, CompletableFuture<Long> done) {
+			this.done = done;
+			int n = transforms.size();
+			this.stages = new Stage[n + 2];
+			this.stages[0] = new Source(in);
+			for(int i = 0; i < n; i++)
+				this.stages[i + 1] = new Transform(transforms.get(i));
+			this.stages[n + 1] = new Sink(out);
+			for(int i = 0; i + 1 < this.stages.length; i++) {
+				SpscRing<List<String>> r = new SpscRing<List<String>>(capacity);
+				this.stages[i].out = r;
+				this.stages[i].next = this.stages[i + 1];
+				this.stages[i + 1].in = r;
+				this.stages[i + 1].prev = this.stages[i];
+			}
+			this.live = new AtomicInteger(this.stages.length);
+			this.drain = this::stopAndWait;
+		}
+
+		void start() {
+			Global.onEnd(this.drain);
+			for(Stage s : this.stages)
+				s.signal();
+		}
+
+		private void stopAndWait() {
+			this.stopped = true;
+			this.stages[0].signal();
+			try {
+				this.done.join();
+			} catch(RuntimeException re) {
+			}
+		}
+
+		// The first error wins; every stage then releases what it holds.
+		void fail(Throwable t) {
+			synchronized(this) {
+				if(this.error == null) this.error = t;
+			}
+			for(Stage s : this.stages)
+				s.signal();
+		}
+
+		void stageDone() {
+			if(this.live.decrementAndGet() > 0) return;
+			Global.removeOnEnd(this.drain);
+			if(this.error != null) this.done.completeExceptionally(this.error);
+			else if(this.stopped) this.done.completeExceptionally(new CancellationException("Pipeline stopped after " + this.written + " lines"));
+			else this.done.complete(this.written);
+		}
+
+		private abstract class Stage implements Runnable
+		{
+
+			SpscRing<List<String>> in;
+
+			SpscRing<List<String>> out;
+
+			Stage prev;
+
+			Stage next;
+
+			private AtomicBoolean scheduled = new AtomicBoolean();
+
+			// Only touched by the stage's own task.
+			boolean finished;
+
+			void signal() {
+				if(this.scheduled.compareAndSet(false, true))
+					Scheduler.execute(this);
+			}
+
+			// Moves at most one batch; false when it could not.
+			abstract boolean step() throws IOException;
+
+			// Whether step() would find something to do.
+			abstract boolean ready();
+
+			abstract void release();
+
+			void finish() {
+				this.finished = true;
+				release();
+				stageDone();
+			}
+
+			public void run() {
+				int rounds = 0;
+				while(true) {
+					boolean progress = false;
+					if(!this.finished) {
+						try {
+							if(error != null) finish();
+							else progress = step();
+						} catch(Throwable t) {
+							fail(t);
+						}
+					}
+					if(progress) {
+						if(++rounds < ROUNDS) continue;
+						// Still scheduled: this just goes to the back of the queue.
+						Scheduler.execute(this);
+						return;
+					}
+					this.scheduled.set(false);
+					// A neighbour that signalled between step() and the reset
+					// above found the flag still set.
+					if(this.finished || !(error != null || ready()) || !this.scheduled.compareAndSet(false, true)) return;
+				}
+			}
+
+		}
+
+		private class Source extends Stage
+		{
+
+			private LineSource src;
+
+			private CancellationToken token = source.token();
+
+			Source(LineSource src) {
+				this.src = src;
+			}
+
+			boolean ready() {
+				return !this.out.isFull() || stopped;
+			}
+
+			boolean step() throws IOException {
+				if(stopped || this.token.isCancelled()) {
+					stopped = true;
+					end();
+					return true;
+				}
+				if(this.out.isFull()) return false;
+				ArrayList<String> b = new ArrayList<String>(lines);
+				String s = null;
+				while(b.size() < lines && (s = this.src.readLine()) != null)
+					b.add(s);
+				if(!b.isEmpty()) {
+					this.out.offer(b);
+					this.next.signal();
+				}
+				if(s == null) end();
+				return true;
+			}
+
+			private void end() {
+				this.out.close();
+				this.next.signal();
+				finish();
+			}
+
+			void release() {
+				try {
+					this.src.close();
+				} catch(IOException ioe) {
+					ioe.printStackTrace();
+				}
+			}
+
+		}
+
+		private class Transform extends Stage
+		{
+
+			private Function<List<String>, List<String>> f;
+
+			Transform(Function<List<String>, List<String>> f) {
+				this.f = f;
+			}
+
+			boolean ready() {
+				return !this.out.isFull() && (!this.in.isEmpty() || this.in.isClosed());
+			}
+
+			boolean step() {
+				if(this.out.isFull()) return false;
+				boolean closed = this.in.isClosed();
+				List<String> b = this.in.poll();
+				if(b == null) {
+					if(!closed) return false;
+					this.out.close();
+					this.next.signal();
+					finish();
+					return true;
+				}
+				this.prev.signal();
+				List<String> r = this.f.apply(b);
+				if(r != null && !r.isEmpty()) {
+					this.out.offer(r);
+					this.next.signal();
+				}
+				return true;
+			}
+
+			void release() {
+			}
+
+		}
+
+		private class Sink extends Stage
+		{
+
+			private LineWriter w;
+
+			private long count;
+
+			Sink(LineWriter w) {
+				this.w = w;
+			}
+
+			boolean ready() {
+				return !this.in.isEmpty() || this.in.isClosed();
+			}
+
+			boolean step() throws IOException {
+				boolean closed = this.in.isClosed();
+				List<String> b = this.in.poll();
+				if(b == null) {
+					if(!closed) return false;
+					LineWriter last = this.w;
+					this.w = null;
+					last.close();
+					finish();
+					return true;
+				}
+				this.prev.signal();
+				for(int i = 0; i < b.size(); i++)
+					this.w.writeLine(b.get(i));
+				this.count += b.size();
+				written = this.count;
+				return true;
+			}
+
+			// Only reached with the writer still open after a failure; what
+			// was already written is kept.
+			void release() {
+				if(this.w == null) return;
+				try {
+					this.w.close();
+				} catch(IOException ioe) {
+					ioe.printStackTrace();
+				}
+			}
+
+		}
+
+	}
+
+}
\ No newline at end of file
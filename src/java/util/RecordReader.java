@@ -0,0 +1,255 @@
+import java.io.Closeable;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Future;
+import java.util.zip.CRC32C;
+
+// Reads the files RecordWriter produces, one record at a time or a block
+// at a time. Blocks are read with positioned reads, so readBlock may be
+// called from several threads at once; next() and seek() keep a cursor
+// and belong to one thread.
+public class RecordReader implements Closeable
+{
+
+	private FileInputStream in;
+
+	private FileChannel ch;
+
+	private long size;
+
+	private int flags;
+
+	// Present when the file has an index.
+	private long[] offsets;
+
+	private long[] firsts;
+
+	private long total = -1;
+
+	private long end;
+
+	private ByteBuffer block;
+
+	private int left;
+
+	private long next = RecordWriter.HEADER;
+
+	public RecordReader(File f) throws IOException {
+		this.in = new FileInputStream(f);
+		try {
+			this.ch = this.in.getChannel();
+			this.size = this.ch.size();
+			ByteBuffer h = read(0, RecordWriter.HEADER);
+			if(h.limit() < RecordWriter.HEADER || h.getInt() != RecordWriter.MAGIC)
+				throw new IOException(f + " is not a record file");
+			if(h.getInt() != RecordWriter.VERSION) throw new IOException("Unsupported record file version in " + f);
+			this.flags = h.getInt();
+			this.end = this.size;
+			if((this.flags & RecordWriter.FLAG_INDEX) != 0) loadIndex(f);
+		} catch(IOException | RuntimeException e) {
+			this.in.close();
+			throw e;
+		}
+	}
+
+	private void loadIndex(File f) throws IOException {
+		if(this.size < RecordWriter.HEADER + 1 + 4 + 20) throw new IOException("Corrupt record index in " + f);
+		ByteBuffer t = read(this.size - 20, 20);
+		long records = t.getLong();
+		long at = t.getLong();
+		if(t.getInt() != RecordWriter.INDEX_MAGIC || at < RecordWriter.HEADER || at + 4 > this.size - 20)
+			throw new IOException("Corrupt record index in " + f);
+		int n = read(at, 4).getInt();
+		if(n < 0 || at + 4 + 16L * n != this.size - 20) throw new IOException("Corrupt record index in " + f);
+		ByteBuffer idx = read(at + 4, 16 * n);
+		this.offsets = new long[n];
+		this.firsts = new long[n];
+		for(int i = 0; i < n; i++) {
+			this.offsets[i] = idx.getLong();
+			this.firsts[i] = idx.getLong();
+		}
+		this.total = records;
+		this.end = at;
+	}
+
+	public boolean hasIndex() {
+		return this.offsets != null;
+	}
+
+	// -1 without an index.
+	public long recordCount() {
+		return this.total;
+	}
+
+	public int blockCount() {
+		return hasIndex() ? this.offsets.length : -1;
+	}
+
+	// The next record, or null after the last one.
+	public byte[] next() throws IOException {
+		while(this.left == 0) {
+			if(this.next < 0) return null;
+			Block b = load(this.next);
+			if(b == null) {
+				this.next = -1;
+				return null;
+			}
+			this.block = b.payload;
+			this.left = b.count;
+			this.next = b.next;
+		}
+		this.left--;
+		int len = RecordWriter.getVarint(this.block);
+		if(len < 0 || len > this.block.remaining()) throw new IOException("Corrupt record frame");
+		byte[] r = new byte[len];
+		this.block.get(r);
+		return r;
+	}
+
+	// Moves the cursor so that next() returns record n. Blocks before the
+	// one holding n are not read when there is an index.
+	public void seek(long n) throws IOException {
+		int lo = 0;
+		if(hasIndex()) {
+			int hi = this.offsets.length - 1;
+			while(lo < hi) {
+				int mid = (lo + hi + 1) >>> 1;
+				if(this.firsts[mid] <= n) lo = mid;
+				else hi = mid - 1;
+			}
+		}
+		this.next = hasIndex() && this.offsets.length > 0 ? this.offsets[lo] : RecordWriter.HEADER;
+		this.left = 0;
+		long skip = n - (hasIndex() && this.offsets.length > 0 ? this.firsts[lo] : 0);
+		for(long i = 0; i < skip; i++)
+			if(next() == null) return;
+	}
+
+	// The records of block i of the index.
+	public List<byte[]> readBlock(int i) throws IOException {
+		if(!hasIndex()) throw new IllegalStateException("Record file has no index");
+		Block b = load(this.offsets[i]);
+		if(b == null) throw new IOException("Missing record block " + i);
+		ArrayList<byte[]> out = new ArrayList<byte[]>(b.count);
+		for(int k = 0; k < b.count; k++) {
+			int len = RecordWriter.getVarint(b.payload);
+			if(len < 0 || len > b.payload.remaining()) throw new IOException("Corrupt record frame in block " + i);
+			byte[] r = new byte[len];
+			b.payload.get(r);
+			out.add(r);
+		}
+		return out;
+	}
+
+	// Reads every block as its own task on pool when the file has an index,
+	// and in order on this thread when it does not. Results come back in
+	// file order.
+	public List<List<byte[]>> readAll(ExecutorService pool, CancellationToken token) throws IOException {
+		ArrayList<List<byte[]>> out = new ArrayList<List<byte[]>>();
+		if(!hasIndex()) {
+			ArrayList<byte[]> all = new ArrayList<byte[]>();
+			seek(0);
+			for(byte[] r = next(); r != null; r = next()) {
+				all.add(r);
+				if((all.size() & SFileStream.CHECK_MASK) == 0) token.throwIfCancelled();
+			}
+			out.add(all);
+			return out;
+		}
+		ArrayList<Future<List<byte[]>>> parts = new ArrayList<Future<List<byte[]>>>(this.offsets.length);
+		for(int i = 0; i < this.offsets.length; i++) {
+			final int b = i;
+			parts.add(pool.submit(new Callable<List<byte[]>>() {
+				public List<byte[]> call() throws IOException {
+					token.throwIfCancelled();
+					return readBlock(b);
+				}
+			}));
+		}
+		try {
+			for(int i = 0; i < parts.size(); i++)
+				out.add(join(parts.get(i)));
+		} catch(IOException | RuntimeException e) {
+			for(int i = 0; i < parts.size(); i++)
+				parts.get(i).cancel(false);
+			throw e;
+		}
+		return out;
+	}
+
+	private static <T> T join(Future<T> fut) throws IOException {
+		try {
+			return fut.get();
+		} catch(InterruptedException ie) {
+			Thread.currentThread().interrupt();
+			throw new IOException("Interrupted while reading", ie);
+		} catch(ExecutionException ee) {
+			if(ee.getCause() instanceof IOException) throw (IOException)ee.getCause();
+			if(ee.getCause() instanceof RuntimeException) throw (RuntimeException)ee.getCause();
+			throw new IOException(ee.getCause());
+		}
+	}
+
+	private static class Block
+	{
+
+		final ByteBuffer payload;
+
+		final int count;
+
+		final long next;
+
+		Block(ByteBuffer payload, int count, long next) {
+			this.payload = payload;
+			this.count = count;
+			this.next = next;
+		}
+
+	}
+
+	// The block at offset at, or null at the end marker.
+	private Block load(long at) throws IOException {
+		if(at >= this.end) throw new IOException("Record file truncated at offset " + at);
+		ByteBuffer h = read(at, (int)Math.min(14, this.end - at));
+		int count = RecordWriter.getVarint(h);
+		if(count == 0) return null;
+		int len = RecordWriter.getVarint(h);
+		boolean sums = (this.flags & RecordWriter.FLAG_CHECKSUMS) != 0;
+		// Every record takes at least its one-byte length, so a count above
+		// len is corrupt, and would size readBlock's list from garbage.
+		if(count < 0 || len < 0 || count > len || (sums && h.remaining() < 4)) throw new IOException("Corrupt record block at offset " + at);
+		int crc = sums ? h.getInt() : 0;
+		long start = at + h.position();
+		if(start + len > this.end) throw new IOException("Record file truncated at offset " + at);
+		ByteBuffer p = read(start, len);
+		if(p.limit() < len) throw new IOException("Record file truncated at offset " + at);
+		if(sums) {
+			CRC32C c = new CRC32C();
+			c.update(p.array(), 0, len);
+			if((int)c.getValue() != crc) throw new IOException("Checksum mismatch in record block at offset " + at);
+		}
+		return new Block(p, count, start + len);
+	}
+
+	// Up to n bytes at pos; fewer only at end of file.
+	private ByteBuffer read(long pos, int n) throws IOException {
+		ByteBuffer b = ByteBuffer.allocate(n);
+		while(b.hasRemaining())
+			if(this.ch.read(b, pos + b.position()) < 0) break;
+		b.flip();
+		return b;
+	}
+
+	public void close() throws IOException {
+		this.in.close();
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+import java.io.Closeable;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.Arrays;
+import java.util.zip.CRC32C;
+
+// Writes binary records: a 12-byte header (magic, version, flags), then
+// blocks of records, then an end marker and, unless disabled, a block
+// index. A block is a varint record count, a varint payload length, a
+// CRC32C of the payload when checksums are on, and the payload, made of
+// a varint length and the bytes of each record. Blocks close once they
+// reach blockSize, so a record larger than that gets a block of its own.
+// The index lists each block's offset and first record number and ends
+// with its own offset and INDEX_MAGIC, so readers find it from the end.
+public class RecordWriter implements Closeable
+{
+
+	static final int MAGIC = 0x50485243;
+
+	static final int VERSION = 1;
+
+	static final int INDEX_MAGIC = 0x50485249;
+
+	static final int HEADER = 12;
+
+	static final int FLAG_CHECKSUMS = 1;
+
+	static final int FLAG_INDEX = 2;
+
+	public static final int DEFAULT_BLOCK = 1 << 16;
+
+	private FileChannel ch;
+
+	private int flags;
+
+	private int blockSize;
+
+	private ByteBuffer block;
+
+	private ByteBuffer head = ByteBuffer.allocate(14);
+
+	private CRC32C crc = new CRC32C();
+
+	private int count;
+
+	private long records;
+
+	private long offset;
+
+	private long[] offsets = new long[16];
+
+	private long[] firsts = new long[16];
+
+	private int blocks;
+
+	public RecordWriter(File f) throws IOException {
+		this(f, true, true, DEFAULT_BLOCK);
+	}
+
+	public RecordWriter(File f, boolean index, boolean checksums, int blockSize) throws IOException {
+		this.flags = (index ? FLAG_INDEX : 0) | (checksums ? FLAG_CHECKSUMS : 0);
+		this.blockSize = Math.max(blockSize, 64);
+		this.block = ByteBuffer.allocate(this.blockSize);
+		this.ch = new FileOutputStream(f).getChannel();
+		ByteBuffer h = ByteBuffer.allocate(HEADER);
+		h.putInt(MAGIC).putInt(VERSION).putInt(this.flags).flip();
+		writeFully(h);
+	}
+
+	public long recordCount() {
+		return this.records;
+	}
+
+	public void write(byte[] b) throws IOException {
+		write(b, 0, b.length);
+	}
+
+	public void write(byte[] b, int off, int len) throws IOException {
+		int need = varintSize(len) + len;
+		if(this.count > 0 && this.block.position() + need > this.blockSize) flushBlock();
+		if(need > this.block.remaining()) {
+			ByteBuffer nb = ByteBuffer.allocate(this.block.position() + need);
+			this.block.flip();
+			nb.put(this.block);
+			this.block = nb;
+		}
+		putVarint(this.block, len);
+		this.block.put(b, off, len);
+		this.count++;
+		this.records++;
+	}
+
+	private void flushBlock() throws IOException {
+		if(this.count == 0) return;
+		this.block.flip();
+		this.head.clear();
+		putVarint(this.head, this.count);
+		putVarint(this.head, this.block.limit());
+		if((this.flags & FLAG_CHECKSUMS) != 0) {
+			this.crc.reset();
+			this.crc.update(this.block.array(), 0, this.block.limit());
+			this.head.putInt((int)this.crc.getValue());
+		}
+		this.head.flip();
+		if(this.blocks == this.offsets.length) {
+			this.offsets = Arrays.copyOf(this.offsets, this.blocks * 2);
+			this.firsts = Arrays.copyOf(this.firsts, this.blocks * 2);
+		}
+		this.offsets[this.blocks] = HEADER + this.offset;
+		this.firsts[this.blocks] = this.records - this.count;
+		this.blocks++;
+		this.offset += this.head.remaining() + this.block.remaining();
+		writeFully(this.head);
+		writeFully(this.block);
+		// A block grown for one large record is not kept around.
+		if(this.block.capacity() > this.blockSize) this.block = ByteBuffer.allocate(this.blockSize);
+		this.block.clear();
+		this.count = 0;
+	}
+
+	public void close() throws IOException {
+		if(this.ch == null) return;
+		try {
+			flushBlock();
+			ByteBuffer end = ByteBuffer.allocate(1 + 4 + 16 * this.blocks + 8 + 8 + 4);
+			end.put((byte)0);
+			if((this.flags & FLAG_INDEX) != 0) {
+				long at = HEADER + this.offset + 1;
+				end.putInt(this.blocks);
+				for(int i = 0; i < this.blocks; i++)
+					end.putLong(this.offsets[i]).putLong(this.firsts[i]);
+				end.putLong(this.records).putLong(at).putInt(INDEX_MAGIC);
+			}
+			end.flip();
+			writeFully(end);
+		} finally {
+			this.ch.close();
+			this.ch = null;
+		}
+	}
+
+	private void writeFully(ByteBuffer b) throws IOException {
+		while(b.hasRemaining())
+			this.ch.write(b);
+	}
+
+	static int varintSize(int v) {
+		int n = 1;
+		while((v >>>= 7) != 0) n++;
+		return n;
+	}
+
+	static void putVarint(ByteBuffer b, int v) {
+		while((v & ~0x7f) != 0) {
+			b.put((byte)((v & 0x7f) | 0x80));
+			v >>>= 7;
+		}
+		b.put((byte)v);
+	}
+
+	// Reads a varint at the buffer's position, or returns -1 when it is
+	// cut short or longer than five bytes.
+	static int getVarint(ByteBuffer b) {
+		int v = 0;
+		for(int shift = 0; shift < 35 && b.hasRemaining(); shift += 7) {
+			int c = b.get();
+			v |= (c & 0x7f) << shift;
+			if((c & 0x80) == 0) return (v < 0) ? -1 : v;
+		}
+		return -1;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.List;
+
+// Immutable CharSequence that concatenates by linking instead of copying,
+// for code that builds long strings a piece at a time. Short pieces are
+// still copied together so the tree does not fill up with tiny leaves,
+// and a rope that gets too deep is rebuilt balanced from its leaves.
+public final class Rope implements CharSequence
+{
+
+	public static final Rope EMPTY = new Rope("");
+
+	// Concatenations up to this many chars are copied into one leaf.
+	private static final int FLAT_MAX = 64;
+
+	private static final int MAX_DEPTH = 48;
+
+	private final String leaf;
+
+	private final Rope left;
+
+	private final Rope right;
+
+	private final int length;
+
+	private final int depth;
+
+	private String flat;
+
+	private Rope(String leaf) {
+		this.leaf = leaf;
+		this.left = null;
+		this.right = null;
+		this.length = leaf.length();
+		this.depth = 0;
+	}
+
+	private Rope(Rope left, Rope right) {
+		this.leaf = null;
+		this.left = left;
+		this.right = right;
+		this.length = left.length + right.length;
+		this.depth = Math.max(left.depth, right.depth) + 1;
+	}
+
+	public static Rope of(CharSequence s) {
+		if(s instanceof Rope) return (Rope)s;
+		return (s.length() == 0) ? EMPTY : new Rope(s.toString());
+	}
+
+	public Rope concat(CharSequence s) {
+		Rope r = of(s);
+		if(r.length == 0) return this;
+		if(this.length == 0) return r;
+		if(this.length + r.length <= FLAT_MAX)
+			return new Rope(toString() + r.toString());
+		// Appending a short piece to a short right edge keeps leaves dense.
+		if(this.leaf == null && this.right.leaf != null && this.right.length + r.length <= FLAT_MAX)
+			return join(this.left, new Rope(this.right.toString() + r.toString()));
+		return join(this, r);
+	}
+
+	private static Rope join(Rope a, Rope b) {
+		Rope r = new Rope(a, b);
+		return (r.depth > MAX_DEPTH) ? balance(r) : r;
+	}
+
+	private static Rope balance(Rope r) {
+		ArrayList<Rope> leaves = new ArrayList<Rope>();
+		ArrayDeque<Rope> stack = new ArrayDeque<Rope>();
+		stack.push(r);
+		while(!stack.isEmpty()) {
+			Rope n = stack.pop();
+			if(n.leaf != null) {
+				leaves.add(n);
+			} else {
+				stack.push(n.right);
+				stack.push(n.left);
+			}
+		}
+		return build(leaves, 0, leaves.size());
+	}
+
+	private static Rope build(List<Rope> leaves, int from, int to) {
+		if(to - from == 1) return leaves.get(from);
+		int mid = (from + to) >>> 1;
+		return new Rope(build(leaves, from, mid), build(leaves, mid, to));
+	}
+
+	public int length() {
+		return this.length;
+	}
+
+	public int depth() {
+		return this.depth;
+	}
+
+	public char charAt(int index) {
+		if(index < 0 || index >= this.length) throw new IndexOutOfBoundsException("index " + index);
+		Rope r = this;
+		while(r.leaf == null) {
+			if(index < r.left.length) {
+				r = r.left;
+			} else {
+				index -= r.left.length;
+				r = r.right;
+			}
+		}
+		return r.leaf.charAt(index);
+	}
+
+	public Rope subSequence(int start, int end) {
+		if(start < 0 || end > this.length || start > end)
+			throw new IndexOutOfBoundsException("range [" + start + ", " + end + ")");
+		if(start == 0 && end == this.length) return this;
+		if(start == end) return EMPTY;
+		if(this.leaf != null) return new Rope(this.leaf.substring(start, end));
+		int mid = this.left.length;
+		if(end <= mid) return this.left.subSequence(start, end);
+		if(start >= mid) return this.right.subSequence(start - mid, end - mid);
+		return this.left.subSequence(start, mid).concat(this.right.subSequence(0, end - mid));
+	}
+
+	public String toString() {
+		if(this.flat != null) return this.flat;
+		if(this.leaf != null) return this.leaf;
+		StringBuilder sb = new StringBuilder(this.length);
+		ArrayDeque<Rope> stack = new ArrayDeque<Rope>();
+		stack.push(this);
+		while(!stack.isEmpty()) {
+			Rope r = stack.pop();
+			if(r.leaf != null) {
+				sb.append(r.leaf);
+			} else if(r.flat != null) {
+				sb.append(r.flat);
+			} else {
+				stack.push(r.right);
+				stack.push(r.left);
+			}
+		}
+		this.flat = sb.toString();
+		return this.flat;
+	}
+
+}
\ No newline at end of file
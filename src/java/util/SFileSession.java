@@ -0,0 +1,49 @@
+import java.io.Closeable;
+import java.io.IOException;
+import java.util.Vector;
+
+// A read session over one open SFileStream source. The handle and its
+// buffer stay alive between calls, so each read costs only the bytes it
+// consumes.
+public class SFileSession implements Closeable
+{
+
+	private LineSource src;
+
+	public SFileSession(LineSource src) {
+		this.src = src;
+	}
+
+	public String nextLine() {
+		try {
+			return this.src.readLine();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+
+	public Vector<String> readLines(int n) {
+		Vector<String> v = new Vector<String>(Math.max(n, 1), 1);
+		for(int i = 0; i < n; i++) {
+			String s = nextLine();
+			if(s == null) break;
+			v.addElement(s);
+		}
+		return v;
+	}
+
+	// Bytes consumed so far, or -1 when the source cannot tell.
+	public long position() {
+		return this.src.position();
+	}
+
+	public void close() {
+		try {
+			this.src.close();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+	}
+
+}
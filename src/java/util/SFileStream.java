@@ -1,60 +1,1111 @@
-import java.io.File;
-import java.io.FileReader;
-import java.io.FileWriter;
-import java.io.BufferedReader;
-import java.io.BufferedWriter;
-import java.io.IOException;
-import java.util.Vector;
-
-public class SFileStream
-{
-	
-	public File f;
-	
-	public SFileStream(String fname) {
-		this.f = new File(fname);
-	}
-	
-	public SFileStream(File file) {
-		this.f = file;
-	}
-	
-	public String singleRead() {
-		try {
-			BufferedReader br = new BufferedReader(new FileReader(this.f));
-			String st =  br.readLine();
-			br.close();
-			return st;
-		} catch(IOException ioe) {
-			ioe.printStackTrace();
-		}
-		return null;
-	}
-	
-	public Vector<String> vectorRead() {
-		Vector<String> v = new Vector<String>(1,1);
-		try {
-			BufferedReader br = new BufferedReader(new FileReader(this.f));
-			while(true) {
-				String s = br.readLine();
-				if(s == null) break;
-				v.addElement(s);
-			}
-			br.close();
-		} catch(IOException ioe) {
-			ioe.printStackTrace();
-		}
-		return v;
-	}
-	
-	public void vectorWrite(Vector<String> v) {
-		try {
-			BufferedWriter bw = new BufferedWriter(new FileWriter(this.f));
-			for(int i = 0; i < v.size(); i++)
-				bw.write(v.elementAt(i));
-			bw.close();
-		} catch(IOException ioe) {
-			ioe.printStackTrace();
-		}
-	}
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.InputStream;
+import java.io.InputStreamReader;
+import java.io.BufferedReader;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.Channels;
+import java.nio.channels.FileChannel;
+import java.nio.channels.ReadableByteChannel;
+import java.nio.channels.SeekableByteChannel;
+import java.nio.channels.WritableByteChannel;
+import java.nio.charset.Charset;
+import java.nio.file.Files;
+import java.nio.file.StandardCopyOption;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Comparator;
+import java.util.List;
+import java.util.Vector;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.function.BiConsumer;
+import java.util.stream.Stream;
+
+public class SFileStream
+{
+	
+	// Lines between cancellation checks, minus one.
+	static final int CHECK_MASK = 4095;
+	
+	private static final Metrics.Counter READ_LINES = Metrics.counter("sfile.read.lines");
+	
+	private static final Metrics.Counter READ_BYTES = Metrics.counter("sfile.read.bytes");
+	
+	private static final Metrics.Counter WRITE_LINES = Metrics.counter("sfile.write.lines");
+	
+	private static final Metrics.Counter WRITE_BYTES = Metrics.counter("sfile.write.bytes");
+	
+	private static final Metrics.Counter ERRORS = Metrics.counter("sfile.errors");
+	
+	// Latency in nanoseconds; each histogram's count is the call count.
+	private static final Metrics.Histogram SINGLE_READ = Metrics.histogram("sfile.singleRead.ns");
+	
+	private static final Metrics.Histogram VECTOR_READ = Metrics.histogram("sfile.vectorRead.ns");
+	
+	private static final Metrics.Histogram VECTOR_WRITE = Metrics.histogram("sfile.vectorWrite.ns");
+	
+	public File f;
+	
+	private Charset charset = Charset.defaultCharset();
+	
+	private boolean mapped;
+	
+	private boolean directIO;
+	
+	private MappedFile mapping;
+	
+	private LineIndex index;
+	
+	private AsyncWriter writer;
+	
+	private CancellationToken token;
+	
+	private StringTable strings;
+	
+	private FileCache cache;
+	
+	public SFileStream(String fname) {
+		this.f = new File(fname);
+	}
+	
+	public SFileStream(File file) {
+		this.f = file;
+	}
+	
+	public SFileStream(String fname, Charset cs) {
+		this(new File(fname), cs);
+	}
+	
+	public SFileStream(File file, Charset cs) {
+		this.f = file;
+		this.charset = cs;
+	}
+	
+	public static SFileStream mapped(String fname) {
+		return mapped(new File(fname));
+	}
+	
+	public static SFileStream mapped(File file) {
+		return mapped(file, Charset.defaultCharset());
+	}
+	
+	public static SFileStream mapped(File file, Charset cs) {
+		SFileStream sf = new SFileStream(file, cs);
+		sf.mapped = true;
+		return sf;
+	}
+	
+	public Charset charset() {
+		return this.charset;
+	}
+	
+	// Long-running reads check this token every few thousand lines and
+	// throw CancellationException once it is cancelled. Without one they
+	// follow Global.token(), so they stop when the program ends.
+	public SFileStream withToken(CancellationToken t) {
+		this.token = t;
+		return this;
+	}
+	
+	public CancellationToken token() {
+		return (this.token != null) ? this.token : Global.token();
+	}
+	
+	// Lines read into Vectors are interned in t, so repeated lines share one
+	// String. A table can be shared by any number of streams and threads.
+	public SFileStream withInterning(StringTable t) {
+		this.strings = t;
+		return this;
+	}
+	
+	public StringTable strings() {
+		return this.strings;
+	}
+	
+	// vectorRead() serves the file from c while its size and mtime are
+	// unchanged, and fills c on a miss.
+	public SFileStream withCache(FileCache c) {
+		this.cache = c;
+		return this;
+	}
+	
+	public SFileStream cached() {
+		return withCache(FileCache.shared());
+	}
+	
+	// True for gzip, BGZF and zstd files, which every read decompresses.
+	public boolean isCompressed() {
+		try {
+			return compression() != Compression.Format.NONE;
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return false;
+	}
+	
+	public boolean isMapped() {
+		return this.mapped;
+	}
+	
+	// Opens the file with O_DIRECT for the reads and writes that go
+	// through the native backend, so large transfers skip the page cache.
+	// Without the runtime, or on file systems that refuse it, this has no
+	// effect. Mapped reads always use the page cache.
+	public SFileStream withDirectIO(boolean direct) {
+		this.directIO = direct;
+		return this;
+	}
+	
+	public boolean isDirectIO() {
+		return this.directIO;
+	}
+	
+	// Through the native backend's pread when it is loaded, else a
+	// FileChannel.
+	private SeekableByteChannel openRead() throws IOException {
+		if(NativeFile.ENABLED)
+			return NativeFile.open(this.f, NativeFile.READ | (this.directIO ? NativeFile.DIRECT : 0));
+		return new FileInputStream(this.f).getChannel();
+	}
+	
+	// Truncates the file first, as FileOutputStream does.
+	WritableByteChannel openWrite() throws IOException {
+		return openWrite(this.f);
+	}
+	
+	// Another file, written the way this stream writes its own.
+	private WritableByteChannel openWrite(File target) throws IOException {
+		if(NativeFile.ENABLED)
+			return NativeFile.open(target, NativeFile.WRITE | NativeFile.CREATE | NativeFile.TRUNCATE | (this.directIO ? NativeFile.DIRECT : 0));
+		return new FileOutputStream(target).getChannel();
+	}
+	
+	private MappedFile mapping() throws IOException {
+		if(this.mapping == null || this.mapping.isStale(this.f))
+			this.mapping = MappedFile.map(this.f);
+		return this.mapping;
+	}
+	
+	// Compressed files are always decoded from a stream, even when mapped.
+	LineSource openSource() throws IOException {
+		boolean ascii = LineScanner.isAsciiCompatible(this.charset);
+		// The cursor splits bytes at '\n', which needs an ASCII-compatible
+		// charset; others are decoded through a Reader below.
+		if(this.mapped && ascii) {
+			MappedFile m = mapping();
+			if(m.segmentCount() == 0 || Compression.detect(m.segment(0)) == Compression.Format.NONE)
+				return m.cursor(this.charset);
+		}
+		SeekableByteChannel ch = openRead();
+		Compression.Format fmt;
+		try {
+			fmt = Compression.detect(ch);
+		} catch(IOException ioe) {
+			ch.close();
+			throw ioe;
+		}
+		if(fmt == Compression.Format.NONE && ascii) return new LineReader(ch, this.charset);
+		InputStream z = Compression.open(ch, fmt);
+		if(ascii) return new LineReader(Channels.newChannel(z), this.charset);
+		return new ReaderSource(new BufferedReader(new InputStreamReader(z, this.charset)), this.charset);
+	}
+	
+	private Compression.Format compression() throws IOException {
+		if(this.mapped) {
+			MappedFile m = mapping();
+			return (m.segmentCount() == 0) ? Compression.Format.NONE : Compression.detect(m.segment(0));
+		}
+		return Compression.detect(this.f);
+	}
+	
+	public SFileSession open() {
+		try {
+			return new SFileSession(openSource());
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+	
+	public String singleRead() {
+		long t0 = System.nanoTime();
+		long tr = Trace.start();
+		try {
+			LineSource src = openSource();
+			String st = src.readLine();
+			long pos = src.position();
+			src.close();
+			if(st != null) READ_LINES.increment();
+			if(pos > 0) READ_BYTES.add(pos);
+			SINGLE_READ.recordSince(t0);
+			Trace.end(tr, "singleRead", this.f.getPath(), pos);
+			return st;
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+	
+	public Vector<String> vectorRead() {
+		Vector<String> v = new Vector<String>(1,1);
+		if(this.cache == null) {
+			readLines(v);
+			return v;
+		}
+		// A failed read is not cached; the caller gets what was read.
+		List<String> l = this.cache.lines(this.f, this.charset, () -> readLines(v) ? v : null);
+		return (l != null) ? toVector(l) : v;
+	}
+	
+	// A miss hands back the Vector just read; a hit is copied so callers
+	// never see the cached lines change under them.
+	@SuppressWarnings("unchecked")
+	private static Vector<String> toVector(List<String> l) {
+		return (l instanceof Vector) ? (Vector<String>)l : new Vector<String>(l);
+	}
+	
+	// Appends the file's lines to v; false when the read failed part way.
+	private boolean readLines(Vector<String> v) {
+		long t0 = System.nanoTime();
+		long tr = Trace.start();
+		CancellationToken ct = token();
+		try {
+			LineSource src = openSource();
+			// Byte-level sources can look lines up without decoding them.
+			ByteLine line = (this.strings != null && !(src instanceof ReaderSource)) ? new ByteLine(this.charset) : null;
+			try {
+				while(true) {
+					String s;
+					if(line != null) {
+						s = src.readLine(line) ? line.intern(this.strings) : null;
+					} else {
+						s = src.readLine();
+						if(s != null && this.strings != null) s = this.strings.intern(s);
+					}
+					if(s == null) break;
+					v.addElement(s);
+					if((v.size() & CHECK_MASK) == 0) ct.throwIfCancelled();
+				}
+				recordRead(t0, tr, v.size(), src.position());
+			} finally {
+				src.close();
+			}
+			return true;
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return false;
+	}
+	
+	// A source that cannot report its position has read the whole file.
+	private void recordRead(long t0, long tr, long lines, long bytes) {
+		if(bytes < 0 && (Metrics.ENABLED || tr != 0)) bytes = this.f.length();
+		if(Metrics.ENABLED) {
+			READ_LINES.add(lines);
+			READ_BYTES.add(bytes);
+			VECTOR_READ.recordSince(t0);
+		}
+		Trace.end(tr, "vectorRead", this.f.getPath(), bytes);
+	}
+	
+	// Decodes the file as independent line-aligned chunks on the shared
+	// Scheduler, split for the given degree of parallelism.
+	public Vector<String> vectorRead(int parallelism) {
+		if(parallelism <= 1) return vectorRead();
+		return vectorRead(Scheduler.pool(), parallelism);
+	}
+	
+	public Vector<String> vectorRead(ExecutorService pool, int parallelism) {
+		if(!LineScanner.isAsciiCompatible(this.charset)) return vectorRead();
+		Vector<String> v = new Vector<String>(1,1);
+		if(this.cache == null) {
+			readChunks(v, pool, parallelism);
+			return v;
+		}
+		List<String> l = this.cache.lines(this.f, this.charset, () -> readChunks(v, pool, parallelism) ? v : null);
+		return (l != null) ? toVector(l) : v;
+	}
+	
+	private boolean readChunks(Vector<String> v, ExecutorService pool, int parallelism) {
+		long t0 = System.nanoTime();
+		long tr = Trace.start();
+		try {
+			// BGZF blocks inflate independently; other compressed formats
+			// can only be read from the start.
+			Compression.Format fmt = compression();
+			if(fmt != Compression.Format.NONE && fmt != Compression.Format.BGZF) return readLines(v);
+			List<List<String>> parts = (fmt == Compression.Format.BGZF)
+				? Compression.readBgzf(this.f, this.charset, this.strings, pool, token())
+				: ParallelReader.read(this.f, this.charset, this.strings, pool, parallelism, token());
+			int n = 0;
+			for(int i = 0; i < parts.size(); i++)
+				n += parts.get(i).size();
+			v.ensureCapacity(n);
+			for(int i = 0; i < parts.size(); i++)
+				v.addAll(parts.get(i));
+			recordRead(t0, tr, n, -1);
+			return true;
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return false;
+	}
+	
+	// Reads the whole file into one shared char array with a line offset
+	// table instead of one String per line.
+	public LineBuffer bufferRead() {
+		try {
+			Compression.Format fmt = compression();
+			if(this.mapped && fmt == Compression.Format.NONE)
+				return LineBuffer.decode(mapping(), this.charset);
+			InputStream z = Compression.open(openRead(), fmt);
+			InputStreamReader r = new InputStreamReader(z, this.charset);
+			try {
+				return LineBuffer.read(r, this.f.length());
+			} finally {
+				r.close();
+			}
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+	
+	// Splits every line at delim into columns over one buffer holding the
+	// whole file, keeping only the listed columns, or all of them when
+	// none are listed; see Columns. The file must fit in 2 GB, and the
+	// charset must be ASCII-compatible.
+	public Columns readDelimited(char delim, int... columns) {
+		return readDelimited(delim, false, columns);
+	}
+	
+	// With header set, the first line names the columns.
+	public Columns readDelimited(char delim, boolean header, int... columns) {
+		if(delim >= 0x80) throw new IllegalArgumentException("Delimiter must be an ASCII character");
+		long t0 = System.nanoTime();
+		long tr = Trace.start();
+		try {
+			ByteBuffer data = wholeFile();
+			Columns c = Columns.parse(data, this.charset, this.strings, (byte)delim, header, columns, token());
+			recordRead(t0, tr, c.rowCount(), data.remaining());
+			return c;
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+	
+	// The mapping itself when mapped, else the file read, or decompressed,
+	// onto the heap.
+	private ByteBuffer wholeFile() throws IOException {
+		Compression.Format fmt = compression();
+		if(this.mapped && fmt == Compression.Format.NONE) {
+			MappedFile m = mapping();
+			if(m.segmentCount() > 1) throw new IOException("File too large for one buffer: " + this.f);
+			return (m.segmentCount() == 0) ? ByteBuffer.allocate(0) : m.segment(0).duplicate();
+		}
+		if(fmt != Compression.Format.NONE) {
+			InputStream z = Compression.open(openRead(), fmt);
+			try {
+				return ByteBuffer.wrap(z.readAllBytes());
+			} finally {
+				z.close();
+			}
+		}
+		SeekableByteChannel ch = openRead();
+		try {
+			long size = ch.size();
+			if(size > Integer.MAX_VALUE - 8) throw new IOException("File too large for one buffer: " + this.f);
+			ByteBuffer b = ByteBuffer.allocate((int)size);
+			while(b.hasRemaining())
+				if(ch.read(b) < 0) break;
+			b.flip();
+			return b;
+		} finally {
+			ch.close();
+		}
+	}
+	
+	// The lines that contain pattern, searched for in the raw bytes so
+	// that only those lines are ever decoded.
+	public Vector<String> grep(String pattern) {
+		List<LineMatch> m = find(pattern, false);
+		Vector<String> v = new Vector<String>(Math.max(m.size(), 1), 1);
+		for(int i = 0; i < m.size(); i++)
+			v.addElement(m.get(i).text());
+		return v;
+	}
+	
+	public List<LineMatch> find(String pattern) {
+		return find(pattern, false);
+	}
+	
+	// Like grep, with each line's offset. With numbered set, line numbers
+	// come from the line index, built or refreshed first if needed, so a
+	// persisted sidecar makes them free; compressed files get none.
+	// Charsets whose line ends are not plain bytes are searched line by
+	// line, counting line numbers and giving no offsets.
+	public List<LineMatch> find(String pattern, boolean numbered) {
+		if(pattern.indexOf('\n') >= 0 || pattern.indexOf('\r') >= 0)
+			throw new IllegalArgumentException("Pattern spans a line end");
+		long tr = Trace.start();
+		ArrayList<LineMatch> out = new ArrayList<LineMatch>();
+		try {
+			if(!LineScanner.isAsciiCompatible(this.charset)) {
+				findLines(pattern, numbered, out);
+			} else {
+				Compression.Format fmt = compression();
+				LineIndex idx = (numbered && fmt == Compression.Format.NONE) ? index() : null;
+				byte[] needle = pattern.getBytes(this.charset);
+				LineDecoder dec = new LineDecoder(this.charset, this.strings);
+				if(this.mapped && fmt == Compression.Format.NONE) {
+					MappedFile m = mapping();
+					for(int i = 0; i < m.segmentCount(); i++) {
+						ByteBuffer b = m.segment(i);
+						match(b, 0, b.limit(), m.segmentStart(i), needle, dec, idx, out);
+					}
+				} else {
+					findStream(fmt, needle, dec, idx, out);
+				}
+			}
+			Trace.end(tr, "find", this.f.getPath(), this.f.length());
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return out;
+	}
+	
+	// Reads in pooled buffers and searches only up to the last complete
+	// line of each; the rest moves to the front for the next read, and
+	// the buffer doubles when a single line does not fit.
+	private void findStream(Compression.Format fmt, byte[] needle, LineDecoder dec, LineIndex idx, List<LineMatch> out) throws IOException {
+		ReadableByteChannel ch = (fmt == Compression.Format.NONE) ? openRead() : Channels.newChannel(Compression.open(openRead(), fmt));
+		ByteBuffer buf = BufferPool.acquire(1 << 20);
+		CancellationToken ct = token();
+		try {
+			long base = 0;
+			boolean eof = false;
+			while(!eof) {
+				if(!buf.hasRemaining()) {
+					ByteBuffer big = BufferPool.acquire(buf.capacity() * 2);
+					buf.flip();
+					big.put(buf);
+					BufferPool.release(buf);
+					buf = big;
+				}
+				eof = ch.read(buf) < 0;
+				int lim = buf.position();
+				int cut = eof ? lim : LineScanner.lastIndexOf(buf, (byte)'\n', 0, lim) + 1;
+				// Only a lone '\r' can end a line there; one at the very end
+				// may be the first half of a "\r\n".
+				if(cut == 0 && !eof) {
+					int cr = LineScanner.lastIndexOf(buf, (byte)'\r', 0, lim - 1);
+					cut = cr + 1;
+				}
+				match(buf, 0, cut, base, needle, dec, idx, out);
+				buf.limit(lim);
+				buf.position(cut);
+				buf.compact();
+				base += cut;
+				ct.throwIfCancelled();
+			}
+		} finally {
+			BufferPool.release(buf);
+			ch.close();
+		}
+	}
+	
+	// Adds every line in [from, to) of b that contains needle; the range
+	// must start at a line start and end at a line end.
+	private static void match(ByteBuffer b, int from, int to, long base, byte[] needle, LineDecoder dec, LineIndex idx,
+			List<LineMatch> out) {
+		int i = from;
+		while(i < to) {
+			int p = LineScanner.indexOf(b, needle, i, to);
+			if(p < 0) break;
+			int start = LineScanner.lastIndexOfEol(b, i, p) + 1;
+			if(start == 0) start = i;
+			int eol = LineScanner.indexOfEol(b, p + needle.length, to);
+			int end = (eol < 0) ? to : eol;
+			long off = base + start;
+			out.add(new LineMatch(off, (idx != null) ? idx.lineOf(off) : -1, dec.decode(b, start, end - start)));
+			i = (eol < 0) ? to : LineScanner.skipEol(b, eol, to);
+		}
+	}
+	
+	private void findLines(String pattern, boolean numbered, List<LineMatch> out) throws IOException {
+		LineSource src = openSource();
+		CancellationToken ct = token();
+		try {
+			long n = 0;
+			for(String s = src.readLine(); s != null; s = src.readLine(), n++) {
+				if(s.contains(pattern)) out.add(new LineMatch(-1, numbered ? n : -1, (this.strings != null) ? this.strings.intern(s) : s));
+				if((n & CHECK_MASK) == 0) ct.throwIfCancelled();
+			}
+		} finally {
+			src.close();
+		}
+	}
+	
+	// Streams this file's lines through transforms into another file with
+	// bounded memory; see Pipeline.
+	public Pipeline pipeline() {
+		return new Pipeline(this);
+	}
+	
+	// Lazily reads one line at a time from a single open source, which is
+	// closed once the iterator is exhausted or closed early.
+	public LineIterator iterator() {
+		try {
+			return new LineIterator(openSource(), token());
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return new LineIterator(null);
+	}
+	
+	public Stream<String> lines() {
+		return iterator().stream();
+	}
+	
+	// Visits every line as raw bytes, decoding nothing unless the visitor
+	// asks for a String. Returns the number of lines visited.
+	public long scan(LineVisitor visitor) {
+		long n = 0;
+		long tr = Trace.start();
+		CancellationToken ct = token();
+		try {
+			LineSource src = openSource();
+			try {
+				ByteLine line = new ByteLine(this.charset);
+				while(src.readLine(line)) {
+					n++;
+					if(!visitor.visit(line)) break;
+					if((n & CHECK_MASK) == 0) ct.throwIfCancelled();
+				}
+				Trace.end(tr, "scan", this.f.getPath(), src.position());
+			} finally {
+				src.close();
+			}
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return n;
+	}
+	
+	public LineIndex buildIndex() {
+		return buildIndex(false);
+	}
+	
+	// With persist set, a sidecar index next to the file is reused while
+	// its recorded size and mtime still match, and rewritten otherwise.
+	public LineIndex buildIndex(boolean persist) {
+		try {
+			File side = LineIndex.sidecar(this.f);
+			LineIndex idx = null;
+			if(persist) {
+				try {
+					idx = LineIndex.load(side, this.f);
+				} catch(IOException ioe) {
+					idx = null;
+				}
+			}
+			if(idx == null) {
+				idx = LineIndex.build(this.f, token());
+				if(persist) idx.save(side);
+			}
+			this.index = idx;
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return this.index;
+	}
+	
+	private LineIndex index() {
+		if(this.index == null || this.index.isStale(this.f))
+			buildIndex(false);
+		return this.index;
+	}
+	
+	public String readLine(long n) {
+		Vector<String> v = readRange(n, n + 1);
+		return v.isEmpty() ? null : v.elementAt(0);
+	}
+	
+	// Reads lines [from, to) with a single positioned read of their bytes.
+	public Vector<String> readRange(long from, long to) {
+		Vector<String> v = new Vector<String>(1,1);
+		LineIndex idx = index();
+		if(idx == null) return v;
+		from = Math.max(from, 0);
+		to = Math.min(to, idx.lineCount());
+		if(from >= to) return v;
+		long start = idx.start(from);
+		long len = idx.start(to) - start;
+		if(len > Integer.MAX_VALUE) throw new IllegalArgumentException("Line range exceeds 2 GB");
+		long tr = Trace.start();
+		try {
+			SeekableByteChannel ch = openRead();
+			try {
+				ByteBuffer buf = ByteBuffer.allocate((int)len);
+				ch.position(start);
+				while(buf.hasRemaining())
+					if(ch.read(buf) < 0) break;
+				LineScanner.split(buf, 0, buf.position(), new LineDecoder(this.charset, this.strings), v);
+				Trace.end(tr, "readRange", this.f.getPath(), buf.position());
+			} finally {
+				ch.close();
+			}
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return v;
+	}
+	
+	public void vectorWrite(Vector<String> v) {
+		long t0 = System.nanoTime();
+		long tr = Trace.start();
+		try {
+			LineWriter w = new LineWriter(openWrite(), this.charset);
+			try {
+				for(int i = 0; i < v.size(); i++)
+					w.write(v.elementAt(i));
+			} finally {
+				w.close();
+			}
+			// The file was truncated, so its length is what was written.
+			if(Metrics.ENABLED || tr != 0) {
+				long bytes = this.f.length();
+				if(Metrics.ENABLED) {
+					WRITE_LINES.add(v.size());
+					WRITE_BYTES.add(bytes);
+					VECTOR_WRITE.recordSince(t0);
+				}
+				Trace.end(tr, "vectorWrite", this.f.getPath(), bytes);
+			}
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+	}
+	
+	// The shared write-behind queue for this file. It truncates the file
+	// when first opened; batches written through it are appended in order.
+	public synchronized AsyncWriter asyncWriter() {
+		try {
+			if(this.writer == null || this.writer.isClosed())
+				this.writer = new AsyncWriter(this.f, this.charset);
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+			return null;
+		}
+		return this.writer;
+	}
+	
+	public CompletableFuture<Void> vectorWriteAsync(Vector<String> v) {
+		AsyncWriter w = asyncWriter();
+		if(w == null) {
+			CompletableFuture<Void> failed = new CompletableFuture<Void>();
+			failed.completeExceptionally(new IOException("Cannot open " + this.f + " for writing"));
+			return failed;
+		}
+		return w.write(v);
+	}
+	
+	// Binary records in RecordWriter's format: length-prefixed frames in
+	// checksummed blocks with a block index, so nothing is parsed as text
+	// and readers can seek or split the file by block.
+	public void writeRecords(Collection<byte[]> records) {
+		long tr = Trace.start();
+		try {
+			RecordWriter w = new RecordWriter(this.f);
+			try {
+				for(byte[] r : records)
+					w.write(r);
+			} finally {
+				w.close();
+			}
+			long bytes = this.f.length();
+			WRITE_BYTES.add(bytes);
+			Trace.end(tr, "writeRecords", this.f.getPath(), bytes);
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+	}
+	
+	public Vector<byte[]> readRecords() {
+		return readRecords(1);
+	}
+	
+	// Blocks are decoded on the shared Scheduler when parallelism > 1.
+	public Vector<byte[]> readRecords(int parallelism) {
+		long tr = Trace.start();
+		Vector<byte[]> v = new Vector<byte[]>(1,1);
+		try {
+			RecordReader rr = new RecordReader(this.f);
+			try {
+				if(parallelism <= 1 || !rr.hasIndex()) {
+					CancellationToken ct = token();
+					for(byte[] r = rr.next(); r != null; r = rr.next()) {
+						v.addElement(r);
+						if((v.size() & CHECK_MASK) == 0) ct.throwIfCancelled();
+					}
+				} else {
+					List<List<byte[]>> parts = rr.readAll(Scheduler.pool(), token());
+					v.ensureCapacity((int)rr.recordCount());
+					for(int i = 0; i < parts.size(); i++)
+						v.addAll(parts.get(i));
+				}
+			} finally {
+				rr.close();
+			}
+			long bytes = this.f.length();
+			READ_BYTES.add(bytes);
+			Trace.end(tr, "readRecords", this.f.getPath(), bytes);
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return v;
+	}
+	
+	// A cursor over the records for seeking and streaming; the caller
+	// closes it.
+	public RecordReader records() {
+		try {
+			return new RecordReader(this.f);
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return null;
+	}
+	
+	// Writes this file's lines to out in cmp's order (natural order when
+	// cmp is null) using about memoryBudget bytes of heap, spilling sorted
+	// runs to disk when the file does not fit; see ExternalSort. Equal
+	// lines keep their input order. Returns the lines written, or -1. out
+	// may be this file: the sorted lines then go to a temporary file next
+	// to it, which replaces it once the sort has finished.
+	public long sortTo(SFileStream out, Comparator<String> cmp, long memoryBudget) {
+		long tr = Trace.start();
+		try {
+			Comparator<String> order = (cmp != null) ? cmp : Comparator.<String>naturalOrder();
+			String tmp = System.getProperty("photon.sort.dir");
+			File parent = out.f.getAbsoluteFile().getParentFile();
+			File dir = (tmp != null) ? new File(tmp) : parent;
+			boolean inPlace = out.f.exists() && Files.isSameFile(this.f.toPath(), out.f.toPath());
+			File target = inPlace ? File.createTempFile("photon-sort", ".out", parent) : out.f;
+			try {
+				long n;
+				long bytes;
+				LineSource src = openSource();
+				try {
+					LineWriter w = new LineWriter(out.openWrite(target), out.charset());
+					try {
+						n = new ExternalSort(order, memoryBudget, token(), dir).sort(src, w);
+					} finally {
+						w.close();
+					}
+					bytes = w.written();
+				} finally {
+					src.close();
+				}
+				if(inPlace) Files.move(target.toPath(), out.f.toPath(), StandardCopyOption.REPLACE_EXISTING);
+				WRITE_LINES.add(n);
+				Trace.end(tr, "sortTo", out.f.getPath(), bytes);
+				return n;
+			} finally {
+				if(inPlace) target.delete();
+			}
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return -1;
+	}
+	
+	// Replaces dst's file with this one's bytes, as they are: no decoding,
+	// and the line terminators survive. The copy stays in the kernel,
+	// through copy_file_range or sendfile in the native runtime or
+	// FileChannel.transferTo without it. Returns the bytes copied, or -1.
+	public long transferTo(SFileStream dst) {
+		return copyTo(dst, false);
+	}
+	
+	// Like transferTo, but adds this file to the end of dst's.
+	public long appendTo(SFileStream dst) {
+		return copyTo(dst, true);
+	}
+	
+	private long copyTo(SFileStream dst, boolean append) {
+		long tr = Trace.start();
+		try {
+			// Also true for hard links, which opening dst for writing would
+			// otherwise truncate before a byte was read.
+			if(!append && dst.f.exists() && Files.isSameFile(this.f.toPath(), dst.f.toPath())) return this.f.length();
+			long n;
+			if(Native.isAvailable()) {
+				n = Native.copyFile(this.f.getPath(), dst.f.getPath(), append);
+				if(n < 0) throw new IOException("Cannot copy " + this.f + " to " + dst.f + " (errno " + -n + ")");
+			} else {
+				n = transfer(this.f, dst.f, append);
+			}
+			WRITE_BYTES.add(n);
+			Trace.end(tr, append ? "appendTo" : "transferTo", dst.f.getPath(), n);
+			return n;
+		} catch(IOException ioe) {
+			ERRORS.increment();
+			ioe.printStackTrace();
+		}
+		return -1;
+	}
+	
+	private static long transfer(File src, File dst, boolean append) throws IOException {
+		FileInputStream in = new FileInputStream(src);
+		try {
+			FileOutputStream out = new FileOutputStream(dst, append);
+			try {
+				FileChannel ic = in.getChannel();
+				FileChannel oc = out.getChannel();
+				// The source is copied as it was when the call started.
+				long size = ic.size();
+				long pos = 0;
+				while(pos < size) {
+					long n = ic.transferTo(pos, size - pos, oc);
+					if(n <= 0) break;
+					pos += n;
+				}
+				return pos;
+			} finally {
+				out.close();
+			}
+		} finally {
+			in.close();
+		}
+	}
+	
+	// Follows the file from a byte offset at a line start, such as one a
+	// previous Tail reported. Each poll returns only the complete lines
+	// appended since the last one.
+	public Tail tail(long offset) {
+		if(!LineScanner.isAsciiCompatible(this.charset))
+			throw new UnsupportedOperationException("Tail needs an ASCII-compatible charset, not " + this.charset);
+		return new Tail(this.f, this.charset, offset, token());
+	}
+	
+	public Tail tail() {
+		return tail(0);
+	}
+	
+	// Like tail(), but skips what the file holds already.
+	public Tail follow() {
+		return tail(this.f.length());
+	}
+	
+	// Non-blocking variants. Reads go through the runtime's io_uring ring
+	// when it is loaded and through AsynchronousFileChannel otherwise.
+	// Looking for compression reads the file's first bytes, so that
+	// happens on the Scheduler, not the calling thread.
+	public CompletableFuture<String> readAsync() {
+		if(!LineScanner.isAsciiCompatible(this.charset)) return Scheduler.supply(this::singleRead);
+		return Scheduler.supply(() -> isCompressed() ? CompletableFuture.completedFuture(singleRead())
+			: AsyncIO.readFirstLine(this.f, this.charset)).thenCompose(cf -> cf);
+	}
+	
+	public CompletableFuture<Vector<String>> vectorReadAsync() {
+		if(!LineScanner.isAsciiCompatible(this.charset)) return Scheduler.supply(this::vectorRead);
+		return Scheduler.supply(() -> isCompressed() ? CompletableFuture.completedFuture(vectorRead())
+			: readWholeAsync()).thenCompose(cf -> cf);
+	}
+	
+	private CompletableFuture<Vector<String>> readWholeAsync() {
+		NativeRing ring = NativeRing.shared();
+		CompletableFuture<ByteBuffer> data = (ring != null) ? ring.readFile(this.f, true) : AsyncIO.readAll(this.f);
+		final Charset cs = this.charset;
+		final StringTable st = this.strings;
+		return data.thenApplyAsync(buf -> {
+			Vector<String> v = new Vector<String>(1,1);
+			LineScanner.split(buf, 0, buf.limit(), new LineDecoder(cs, st), v);
+			BufferPool.release(buf);
+			return v;
+		}, Scheduler::execute);
+	}
+	
+	// Reads many files with at most parallelism reads in flight, through
+	// the runtime's ring when it is loaded, where each window of reads
+	// goes to the kernel as one batch, and AsyncIO otherwise. Lines are
+	// decoded on the Scheduler as each file arrives. Results are in the
+	// order of files; one that cannot be read gives an empty Vector, as
+	// vectorRead does. An interrupt, or the end of the program, stops the
+	// reads with a CancellationException.
+	public static List<Vector<String>> readAll(Collection<File> files, int parallelism) {
+		return readAll(files, Charset.defaultCharset(), parallelism);
+	}
+	
+	public static List<Vector<String>> readAll(Collection<File> files, Charset cs, int parallelism) {
+		ArrayList<Vector<String>> out = new ArrayList<Vector<String>>(files.size());
+		for(int i = 0; i < files.size(); i++)
+			out.add(null);
+		readEach(new ArrayList<File>(files), cs, parallelism, (i, f, v) -> out.set(i, v));
+		return out;
+	}
+	
+	// The same reads, handing each file's lines to each on the calling
+	// thread as soon as that file is done, so in completion order.
+	public static void readAll(Collection<File> files, Charset cs, int parallelism, BiConsumer<File, Vector<String>> each) {
+		readEach(new ArrayList<File>(files), cs, parallelism, (i, f, v) -> each.accept(f, v));
+	}
+	
+	private interface Done
+	{
+		
+		void accept(int i, File f, Vector<String> v);
+		
+	}
+	
+	private static class Finished
+	{
+		
+		final int index;
+		
+		final Vector<String> lines;
+		
+		final Throwable error;
+		
+		Finished(int index, Vector<String> lines, Throwable error) {
+			this.index = index;
+			this.lines = lines;
+			this.error = error;
+		}
+		
+	}
+	
+	private static void readEach(List<File> files, Charset cs, int parallelism, Done each) {
+		int n = files.size();
+		int window = Math.max(1, parallelism);
+		LinkedBlockingQueue<Finished> done = new LinkedBlockingQueue<Finished>();
+		CancellationToken ct = Global.token();
+		int next = 0;
+		int inflight = 0;
+		while(next < n || inflight > 0) {
+			// Refilled a half window at a time, so each batch handed to the
+			// ring stays large instead of shrinking to one read per slot.
+			if(next < n && inflight <= window / 2) {
+				int k = Math.min(n - next, window - inflight);
+				List<CompletableFuture<Vector<String>>> reads = startReads(files.subList(next, next + k), cs);
+				for(int j = 0; j < k; j++) {
+					final int i = next + j;
+					reads.get(j).whenComplete((v, e) -> done.add(new Finished(i, v, e)));
+				}
+				next += k;
+				inflight += k;
+			}
+			Finished d;
+			try {
+				d = done.take();
+			} catch(InterruptedException ie) {
+				Thread.currentThread().interrupt();
+				throw new CancellationException("Interrupted while reading");
+			}
+			inflight--;
+			Vector<String> v = d.lines;
+			if(d.error != null) {
+				ERRORS.increment();
+				d.error.printStackTrace();
+				v = new Vector<String>(1,1);
+			}
+			each.accept(d.index, files.get(d.index), v);
+			ct.throwIfCancelled();
+		}
+	}
+	
+	private static List<CompletableFuture<Vector<String>>> startReads(List<File> batch, Charset cs) {
+		ArrayList<CompletableFuture<Vector<String>>> out = new ArrayList<CompletableFuture<Vector<String>>>(batch.size());
+		if(!LineScanner.isAsciiCompatible(cs)) {
+			for(File f : batch)
+				out.add(Scheduler.supply(() -> new SFileStream(f, cs).vectorRead()));
+			return out;
+		}
+		NativeRing ring = NativeRing.shared();
+		List<CompletableFuture<ByteBuffer>> data;
+		if(ring != null) {
+			data = ring.readFiles(batch, true);
+		} else {
+			data = new ArrayList<CompletableFuture<ByteBuffer>>(batch.size());
+			for(File f : batch)
+				data.add(AsyncIO.readAll(f));
+		}
+		for(int i = 0; i < batch.size(); i++) {
+			final File f = batch.get(i);
+			out.add(data.get(i).thenApplyAsync(buf -> decodeAll(f, buf, cs), Scheduler::execute));
+		}
+		return out;
+	}
+	
+	// Compressed files are rare enough here to be read again through a
+	// stream. Either way buf goes back to the pool.
+	private static Vector<String> decodeAll(File f, ByteBuffer buf, Charset cs) {
+		try {
+			if(Compression.detect(buf) != Compression.Format.NONE) return new SFileStream(f, cs).vectorRead();
+			Vector<String> v = new Vector<String>(1,1);
+			LineScanner.split(buf, 0, buf.limit(), new LineDecoder(cs), v);
+			READ_LINES.add(v.size());
+			READ_BYTES.add(buf.limit());
+			return v;
+		} finally {
+			BufferPool.release(buf);
+		}
+	}
+	
+	// Replaces the file's contents, like vectorWrite.
+	public CompletableFuture<Void> writeAsync(Vector<String> v) {
+		return AsyncIO.write(this.f, AsyncIO.encode(v, this.charset));
+	}
+	
+	private static class ReaderSource implements LineSource
+	{
+		
+		private BufferedReader br;
+		
+		private Charset charset;
+		
+		ReaderSource(BufferedReader br, Charset cs) {
+			this.br = br;
+			this.charset = cs;
+		}
+		
+		public String readLine() throws IOException {
+			return this.br.readLine();
+		}
+		
+		// Terminators are not plain bytes in these charsets, so the line is
+		// decoded to find its end and then re-encoded.
+		public boolean readLine(ByteLine out) throws IOException {
+			String s = this.br.readLine();
+			if(s == null) return false;
+			byte[] b = s.getBytes(this.charset);
+			out.set(ByteBuffer.wrap(b), 0, b.length);
+			return true;
+		}
+		
+		public long position() {
+			return -1;
+		}
+		
+		public void close() throws IOException {
+			this.br.close();
+		}
+		
+	}
 }
\ No newline at end of file
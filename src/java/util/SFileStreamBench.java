@@ -0,0 +1,284 @@
+import java.io.BufferedOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.PrintWriter;
+import java.nio.charset.Charset;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.Date;
+import java.util.Random;
+import java.util.Vector;
+
+// Microbenchmarks of the SFileStream read and write paths, run by
+// `make bench`. Each case is warmed up and then timed over several
+// iterations, JMH style, for every combination of file size and line
+// length distribution. One tab-separated line per case goes to the
+// output file. Files are read through the page cache, so the numbers are
+// warm-cache figures; cases that keep the whole file in memory are
+// skipped when the heap is too small for them.
+//
+// Usage: SFileStreamBench [-sizes 1K,1M,64M] [-dists short,mixed,long]
+//   [-warmup 3] [-iterations 5] [-budget 10] [-filter name] [-dir .]
+//   [-out bench_output.txt]
+public class SFileStreamBench
+{
+
+	// Keeps the JIT from discarding what a case computed.
+	static volatile long sink;
+
+	private static final Charset CS = StandardCharsets.UTF_8;
+
+	private int warmup = 3;
+
+	private int iterations = 5;
+
+	// Measuring stops after this many seconds once one iteration is in.
+	private long budget = 10;
+
+	private String filter;
+
+	private File dir = new File(".");
+
+	private ArrayList<Case> cases = new ArrayList<Case>();
+
+	private PrintWriter out;
+
+	interface Body
+	{
+
+		long run(File in, File out, Vector<String> lines) throws Exception;
+
+	}
+
+	private static class Case
+	{
+
+		final String name;
+
+		// Set when the case needs the whole file in memory.
+		final boolean resident;
+
+		// Set when the case writes the lines it is given.
+		final boolean writes;
+
+		final Body body;
+
+		Case(String name, boolean resident, boolean writes, Body body) {
+			this.name = name;
+			this.resident = resident;
+			this.writes = writes;
+			this.body = body;
+		}
+
+	}
+
+	// Lengths of generated lines, excluding the terminator.
+	enum Dist
+	{
+
+		SHORT, MIXED, LONG;
+
+		int next(Random r) {
+			switch(this) {
+				case SHORT: return 8 + r.nextInt(24);
+				case LONG: return 4096 + r.nextInt(4096);
+				// Mostly short lines with a long tail, like a typical log.
+				default: return Math.min(16384, (int)Math.exp(2.5 + 1.5 * r.nextGaussian()));
+			}
+		}
+
+	}
+
+	public static void main(String[] args) {
+		SFileStreamBench b = new SFileStreamBench();
+		String sizes = "1K,1M,64M";
+		String dists = "short,mixed,long";
+		String out = "bench_output.txt";
+		for(int i = 0; i + 1 < args.length; i += 2) {
+			String v = args[i + 1];
+			switch(args[i]) {
+				case "-sizes": sizes = v; break;
+				case "-dists": dists = v; break;
+				case "-warmup": b.warmup = Integer.parseInt(v); break;
+				case "-iterations": b.iterations = Math.max(1, Integer.parseInt(v)); break;
+				case "-budget": b.budget = Long.parseLong(v); break;
+				case "-filter": b.filter = v; break;
+				case "-dir": b.dir = new File(v); break;
+				case "-out": out = v; break;
+				default:
+					System.err.println("Unknown option " + args[i]);
+					System.exit(2);
+			}
+		}
+		Global.startProgram();
+		int status = 0;
+		try {
+			b.out = new PrintWriter(new FileWriter(out));
+			b.register();
+			b.run(sizes.split(","), dists.split(","));
+		} catch(Exception e) {
+			e.printStackTrace();
+			status = 1;
+		} finally {
+			if(b.out != null) b.out.close();
+			Global.endProgram();
+		}
+		System.exit(status);
+	}
+
+	private void register() {
+		int par = Scheduler.parallelism();
+		add("singleRead", false, false, (in, o, v) -> new SFileStream(in, CS).singleRead().length());
+		add("vectorRead", true, false, (in, o, v) -> new SFileStream(in, CS).vectorRead().size());
+		add("vectorRead.mapped", true, false, (in, o, v) -> SFileStream.mapped(in, CS).vectorRead().size());
+		add("vectorRead.parallel", true, false, (in, o, v) -> new SFileStream(in, CS).vectorRead(par).size());
+		add("vectorReadAsync", true, false, (in, o, v) -> new SFileStream(in, CS).vectorReadAsync().join().size());
+		add("bufferRead", true, false, (in, o, v) -> new SFileStream(in, CS).bufferRead().size());
+		add("bufferRead.mapped", true, false, (in, o, v) -> SFileStream.mapped(in, CS).bufferRead().size());
+		add("lines", false, false, (in, o, v) -> new SFileStream(in, CS).lines().count());
+		add("scan", false, false, (in, o, v) -> new SFileStream(in, CS).scan(line -> true));
+		add("scan.mapped", false, false, (in, o, v) -> SFileStream.mapped(in, CS).scan(line -> true));
+		add("vectorWrite", true, true, (in, o, v) -> {
+			new SFileStream(o, CS).vectorWrite(v);
+			return o.length();
+		});
+		add("vectorWriteAsync", true, true, (in, o, v) -> {
+			SFileStream sf = new SFileStream(o, CS);
+			sf.vectorWriteAsync(v).join();
+			sf.asyncWriter().close();
+			return o.length();
+		});
+		add("writeAsync", true, true, (in, o, v) -> {
+			new SFileStream(o, CS).writeAsync(v).join();
+			return o.length();
+		});
+	}
+
+	private void add(String name, boolean resident, boolean writes, Body body) {
+		if(this.filter == null || name.contains(this.filter))
+			this.cases.add(new Case(name, resident, writes, body));
+	}
+
+	private void run(String[] sizes, String[] dists) throws Exception {
+		this.out.println("# photon SFileStream benchmarks, " + new Date());
+		this.out.println("# java " + System.getProperty("java.version") + ", " + System.getProperty("os.name")
+			+ " " + System.getProperty("os.arch") + ", scan kernel " + Native.scanKernel()
+			+ ", parallelism " + Scheduler.parallelism() + ", max heap " + (Runtime.getRuntime().maxMemory() >> 20) + " MB");
+		this.out.println("# warmup " + this.warmup + ", iterations " + this.iterations + ", budget " + this.budget + " s");
+		this.out.println("benchmark\tsize\tdist\tbytes\tlines\titerations\tns_op\tns_op_error\tns_op_min\tmb_s\tlines_s");
+		this.out.flush();
+		File in = new File(this.dir, "bench.in");
+		File o = new File(this.dir, "bench.out");
+		try {
+			for(String size : sizes) {
+				for(String dist : dists) {
+					long lines = generate(in, parseSize(size), Dist.valueOf(dist.toUpperCase()));
+					Vector<String> v = null;
+					for(Case c : this.cases) {
+						if(c.resident && !fits(in.length(), lines)) {
+							note("# skipped " + c.name + " " + size + " " + dist + ": needs more heap than "
+								+ (Runtime.getRuntime().maxMemory() >> 20) + " MB");
+							continue;
+						}
+						if(c.writes && v == null) v = new SFileStream(in, CS).vectorRead();
+						measure(c, size, dist, in, o, v, lines);
+						o.delete();
+					}
+				}
+			}
+		} finally {
+			in.delete();
+			o.delete();
+		}
+	}
+
+	private void measure(Case c, String size, String dist, File in, File o, Vector<String> v, long lines) throws Exception {
+		long bytes = in.length();
+		for(int i = 0; i < this.warmup; i++)
+			sink += c.body.run(in, o, v);
+		long[] times = new long[this.iterations];
+		long deadline = System.nanoTime() + this.budget * 1000000000L;
+		int n = 0;
+		while(n < times.length && (n == 0 || System.nanoTime() < deadline)) {
+			long t0 = System.nanoTime();
+			sink += c.body.run(in, o, v);
+			times[n++] = System.nanoTime() - t0;
+		}
+		double mean = 0;
+		long min = Long.MAX_VALUE;
+		for(int i = 0; i < n; i++) {
+			mean += times[i];
+			min = Math.min(min, times[i]);
+		}
+		mean /= n;
+		double var = 0;
+		for(int i = 0; i < n; i++)
+			var += (times[i] - mean) * (times[i] - mean);
+		double err = (n > 1) ? Math.sqrt(var / (n - 1)) : 0;
+		// Reading the first line costs the same whatever the file size.
+		long done = c.name.equals("singleRead") ? firstLineBytes(in) : bytes;
+		long doneLines = c.name.equals("singleRead") ? 1 : lines;
+		note(String.format("%s\t%s\t%s\t%d\t%d\t%d\t%.0f\t%.0f\t%d\t%.2f\t%.0f", c.name, size, dist, bytes, lines, n,
+			mean, err, min, done / (mean / 1e9) / (1 << 20), doneLines / (mean / 1e9)));
+	}
+
+	private static long firstLineBytes(File in) {
+		String s = new SFileStream(in, CS).singleRead();
+		return (s == null) ? 0 : Math.min(in.length(), s.getBytes(CS).length + 1);
+	}
+
+	private void note(String line) {
+		this.out.println(line);
+		this.out.flush();
+		System.out.println(line);
+	}
+
+	// Roughly what a Vector of the file's lines costs: two bytes per char
+	// plus the String and array headers of each line, with room to spare
+	// for the copy the JVM makes while decoding.
+	private static boolean fits(long bytes, long lines) {
+		Runtime rt = Runtime.getRuntime();
+		return bytes * 3 + lines * 64 < (long)(rt.maxMemory() * 0.6);
+	}
+
+	static long parseSize(String s) {
+		s = s.trim().toUpperCase();
+		long unit = 1;
+		char c = s.charAt(s.length() - 1);
+		if(c == 'K') unit = 1L << 10;
+		if(c == 'M') unit = 1L << 20;
+		if(c == 'G') unit = 1L << 30;
+		if(unit > 1) s = s.substring(0, s.length() - 1);
+		return Long.parseLong(s) * unit;
+	}
+
+	// Writes ASCII lines of the given distribution until the file holds
+	// size bytes; the last line is cut short to fit. Returns how many lines
+	// were written. The seed is fixed so every run reads the same file.
+	static long generate(File f, long size, Dist dist) throws IOException {
+		Random r = new Random(42);
+		byte[] line = new byte[16384 + 1];
+		long written = 0;
+		long lines = 0;
+		OutputStream os = new BufferedOutputStream(new FileOutputStream(f), 1 << 20);
+		try {
+			while(written < size) {
+				int len = dist.next(r);
+				for(int i = 0; i < len; i++)
+					line[i] = (byte)('a' + (lines + i) % 26);
+				line[len] = '\n';
+				int n = (int)Math.min(len + 1, size - written);
+				os.write(line, 0, n);
+				written += n;
+				lines++;
+			}
+		} finally {
+			os.close();
+		}
+		return lines;
+	}
+
+}
\ No newline at end of file
@@ -1,52 +1,861 @@
-import java.util.Vector;
-
-public class SFileStreamTest
-{
-	private static int EXIT_STATUS;
-	
-	private static Vector<String> endStatus;
-	
-	private static String file;
-	
-	public static void main(String[] args)
-	{
-		System.out.println();
-		System.out.println("Testing (Read/Write) IO Functions ... ");
-		System.out.println();
-		endStatus = new Vector<String>(1,1);
-		file = args[0];
-		singleReadTest();
-		vectorReadTest();
-		displayVector(endStatus);
-		System.exit(EXIT_STATUS);
-	}
-	
-	public static void displayVector(Vector<String> v) {
-		for(int i = 0; i < v.size(); i++)
-			System.out.println(v.elementAt(i));
-	}
-	
-	public static void singleReadTest()
-	{
-		SFileStream sf = new SFileStream(file);
-		if(sf.singleRead().equals("TESTING SINGLE LINE")) {
-			endStatus.addElement("Single Line Read Test : PASS");
-		} else {
-			endStatus.addElement("Single Line Read Test : FAIL");
-			EXIT_STATUS = 1;
-		}
-	}
-	
-	public static void vectorReadTest() {
-		SFileStream sf = new SFileStream(file);
-		Vector<String> res = sf.vectorRead();
-		boolean testResult = (res.elementAt(0).equals("TESTING SINGLE LINE")) && (res.elementAt(1).equals("TESTING MULTIPLE LINES"));
-		if(testResult) {
-			endStatus.addElement("Vector Read Test : PASS");
-		} else {
-			endStatus.addElement("Vector Read Test : FAIL");
-			EXIT_STATUS = 1;
-		}
-	}
-	
+import java.io.File;
+import java.io.ByteArrayOutputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.StandardOpenOption;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Random;
+import java.util.Vector;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ForkJoinTask;
+import java.util.concurrent.TimeUnit;
+import java.util.stream.Stream;
+import java.util.zip.CRC32;
+import java.util.zip.Deflater;
+import java.util.zip.GZIPOutputStream;
+
+public class SFileStreamTest
+{
+	private static int EXIT_STATUS;
+	
+	private static Vector<String> endStatus;
+	
+	private static String file;
+	
+	public static void main(String[] args)
+	{
+		System.out.println();
+		System.out.println("Testing (Read/Write) IO Functions (" + Native.scanKernel() + ") ... ");
+		System.out.println();
+		endStatus = new Vector<String>(1,1);
+		file = args[0];
+		singleReadTest();
+		vectorReadTest();
+		mappedReadTest();
+		linesTest();
+		bufferReadTest();
+		sessionTest();
+		indexTest();
+		parallelReadTest();
+		asyncWriteTest();
+		scanTest();
+		asyncReadTest();
+		charsetTest();
+		byteScanTest();
+		cancelTest();
+		internTest();
+		ropeTest();
+		metricsTest();
+		cacheTest();
+		tailTest();
+		compressedTest();
+		recordTest();
+		bulkReadTest();
+		bufferPoolTest();
+		transferTest();
+		nativeFileTest();
+		delimitedTest();
+		grepTest();
+		pipelineTest();
+		sortTest();
+		displayVector(endStatus);
+		System.exit(EXIT_STATUS);
+	}
+	
+	public static void displayVector(Vector<String> v) {
+		for(int i = 0; i < v.size(); i++)
+			System.out.println(v.elementAt(i));
+	}
+	
+	private static void report(boolean ok, String name) {
+		endStatus.addElement(name + (ok ? " : PASS" : " : FAIL"));
+		if(!ok) EXIT_STATUS = 1;
+	}
+	
+	private interface Check
+	{
+		
+		boolean run() throws Exception;
+		
+	}
+	
+	// Reports check under name, an exception counting as a failure, and
+	// then deletes the scratch files it wrote.
+	private static void check(String name, Check check, File... scratch) {
+		boolean ok = false;
+		try {
+			ok = check.run();
+		} catch(Exception e) {
+			e.printStackTrace();
+		}
+		for(File f : scratch)
+			f.delete();
+		report(ok, name);
+	}
+	
+	public static void singleReadTest()
+	{
+		SFileStream sf = new SFileStream(file);
+		report(sf.singleRead().equals("TESTING SINGLE LINE"), "Single Line Read Test");
+	}
+	
+	public static void vectorReadTest() {
+		SFileStream sf = new SFileStream(file);
+		Vector<String> res = sf.vectorRead();
+		boolean testResult = (res.elementAt(0).equals("TESTING SINGLE LINE")) && (res.elementAt(1).equals("TESTING MULTIPLE LINES"));
+		report(testResult, "Vector Read Test");
+	}
+	
+	public static void mappedReadTest() {
+		SFileStream sf = SFileStream.mapped(file);
+		Vector<String> res = sf.vectorRead();
+		boolean testResult = sf.singleRead().equals("TESTING SINGLE LINE") && (res.size() == 2)
+			&& (res.elementAt(0).equals("TESTING SINGLE LINE")) && (res.elementAt(1).equals("TESTING MULTIPLE LINES"));
+		report(testResult, "Mapped Read Test");
+	}
+	
+	public static void linesTest() {
+		SFileStream sf = new SFileStream(file);
+		LineIterator it = sf.iterator();
+		int count = 0;
+		while(it.hasNext()) {
+			it.next();
+			count++;
+		}
+		Stream<String> st = sf.lines();
+		String first = st.filter(s -> s.startsWith("TESTING")).findFirst().orElse(null);
+		st.close();
+		report(count == 2 && "TESTING SINGLE LINE".equals(first), "Lazy Lines Test");
+	}
+	
+	public static void bufferReadTest() {
+		LineBuffer lb = new SFileStream(file).bufferRead();
+		LineBuffer mb = SFileStream.mapped(file).bufferRead();
+		boolean testResult = (lb.size() == 2) && (mb.size() == 2)
+			&& lb.line(0).toString().equals("TESTING SINGLE LINE")
+			&& lb.line(0).set(1).toString().equals("TESTING MULTIPLE LINES")
+			&& (mb.charAt(1, 8) == 'M') && (mb.length(1) == 22)
+			&& mb.toList().equals(lb.toList());
+		report(testResult, "Buffer Read Test");
+	}
+	
+	public static void sessionTest() {
+		SFileSession ss = new SFileStream(file).open();
+		String first = ss.nextLine();
+		long pos = ss.position();
+		Vector<String> rest = ss.readLines(5);
+		boolean testResult = "TESTING SINGLE LINE".equals(first) && (pos == 20)
+			&& (rest.size() == 1) && rest.elementAt(0).equals("TESTING MULTIPLE LINES")
+			&& (ss.position() == 43) && (ss.nextLine() == null);
+		ss.close();
+		report(testResult, "Read Session Test");
+	}
+	
+	public static void indexTest() {
+		SFileStream sf = new SFileStream(file);
+		LineIndex idx = sf.buildIndex(true);
+		File side = LineIndex.sidecar(sf.f);
+		LineIndex saved = null;
+		try {
+			saved = LineIndex.load(side, sf.f);
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		side.delete();
+		Vector<String> range = sf.readRange(0, 10);
+		boolean testResult = (idx.lineCount() == 2) && (saved != null) && (saved.start(1) == 20)
+			&& "TESTING MULTIPLE LINES".equals(sf.readLine(1)) && (sf.readLine(2) == null)
+			&& (range.size() == 2) && range.elementAt(0).equals("TESTING SINGLE LINE")
+			&& (idx.lineOf(25) == 1);
+		report(testResult, "Line Index Test");
+	}
+	
+	public static void parallelReadTest() {
+		SFileStream sf = new SFileStream(file);
+		Vector<String> res = sf.vectorRead(4);
+		report(res.equals(sf.vectorRead()), "Parallel Vector Read Test");
+		File big = new File("parallel.test");
+		check("Parallel Chunk Boundary Test", () -> {
+			// Several 1 MB chunks. Line lengths vary so the cuts land at
+			// different offsets, and some lines end in "\r\n".
+			ArrayList<String> lines = new ArrayList<String>();
+			StringBuilder sb = new StringBuilder();
+			for(int i = 0; sb.length() < (6 << 20); i++) {
+				String s = "line " + i + " " + new String(new char[i % 61]).replace('\0', 'x');
+				lines.add(s);
+				sb.append(s).append((i % 5 == 0) ? "\r\n" : "\n");
+			}
+			Files.write(big.toPath(), sb.toString().getBytes(StandardCharsets.US_ASCII));
+			List<List<String>> parts = ParallelReader.read(big, StandardCharsets.US_ASCII, Scheduler.pool(), 4, CancellationToken.NONE);
+			ArrayList<String> joined = new ArrayList<String>();
+			for(List<String> part : parts)
+				joined.addAll(part);
+			return parts.size() > 1 && joined.equals(lines) && new SFileStream(big).vectorRead(4).equals(lines);
+		}, big);
+	}
+	
+	public static void asyncWriteTest() {
+		SFileStream sf = new SFileStream("async.test");
+		Vector<String> first = new Vector<String>(1,1);
+		first.addElement("ASYNC ");
+		first.addElement("WRITE ");
+		Vector<String> second = new Vector<String>(1,1);
+		second.addElement("TEST");
+		sf.vectorWriteAsync(first);
+		boolean done = sf.vectorWriteAsync(second).handle((r, t) -> t == null).join();
+		sf.asyncWriter().close();
+		boolean testResult = done && "ASYNC WRITE TEST".equals(sf.singleRead());
+		sf.f.delete();
+		report(testResult, "Async Vector Write Test");
+		File raced = new File("async_race.test");
+		check("Async Write Close Race Test", () -> {
+			// Writers racing close() on a tiny queue: every future completes,
+			// and exactly the batches that succeeded are in the file.
+			AsyncWriter w = new AsyncWriter(raced, StandardCharsets.US_ASCII, 2, false);
+			ConcurrentLinkedQueue<CompletableFuture<Void>> futures = new ConcurrentLinkedQueue<CompletableFuture<Void>>();
+			Thread[] threads = new Thread[4];
+			for(int t = 0; t < threads.length; t++) {
+				final int id = t;
+				threads[t] = new Thread(() -> {
+					for(int i = 0; i < 500; i++)
+						futures.add(w.write(Collections.singletonList("w" + id + " " + i + "\n")));
+				});
+				threads[t].start();
+			}
+			Thread.sleep(2);
+			w.close();
+			for(Thread t : threads)
+				t.join();
+			int written = 0;
+			for(CompletableFuture<Void> f : futures) {
+				try {
+					f.get(10, TimeUnit.SECONDS);
+					written++;
+				} catch(ExecutionException ee) {
+				}
+			}
+			return futures.size() == 2000 && new SFileStream(raced).vectorRead().size() == written;
+		}, raced);
+		File busy = new File("async_busy.test");
+		check("Async Write From Scheduler Test", () -> {
+			// Every worker writes into a one-slot queue, so the drain task
+			// only runs if blocked writers hand their threads back.
+			AsyncWriter w = new AsyncWriter(busy, StandardCharsets.US_ASCII, 1, false);
+			int tasks = Scheduler.parallelism() * 4;
+			ArrayList<ForkJoinTask<Void>> running = new ArrayList<ForkJoinTask<Void>>();
+			for(int t = 0; t < tasks; t++) {
+				running.add(Scheduler.submit(() -> {
+					for(int i = 0; i < 50; i++)
+						w.write(Collections.singletonList("x\n"));
+					return null;
+				}));
+			}
+			for(ForkJoinTask<Void> t : running)
+				t.get(30, TimeUnit.SECONDS);
+			w.close();
+			return new SFileStream(busy).vectorRead().size() == tasks * 50;
+		}, busy);
+	}
+	
+	public static void scanTest() {
+		byte[] data = new byte[1000];
+		for(int i = 0; i < data.length; i++)
+			data[i] = (byte)((i % 97 == 0) ? '\n' : (i % 89 == 0) ? ',' : 'x');
+		ByteBuffer heap = ByteBuffer.wrap(data);
+		ByteBuffer direct = ByteBuffer.allocateDirect(data.length);
+		direct.put(data);
+		int[] a = new int[4];
+		int[] b = new int[4];
+		int na = LineScanner.scan(heap, 1, data.length, (byte)'\n', (byte)',', a);
+		int nb = LineScanner.scan(direct, 1, data.length, (byte)'\n', (byte)',', b);
+		boolean testResult = (na == 4) && (nb == 4) && Arrays.equals(a, b)
+			&& (a[0] == 89) && (a[1] == 97) && (a[2] == 178) && (a[3] == 194)
+			&& (LineScanner.indexOfEol(heap, 98, data.length) == 194)
+			&& (LineScanner.indexOfEol(direct, 98, data.length) == 194);
+		report(testResult, "Line Scan Test");
+	}
+	
+	public static void asyncReadTest() {
+		SFileStream sf = new SFileStream(file);
+		SFileStream out = new SFileStream("async_read.test");
+		Vector<String> lines = new Vector<String>(1,1);
+		lines.addElement("ASYNC\n");
+		lines.addElement("READ\n");
+		check("Async Read Test", () -> {
+			out.writeAsync(lines).join();
+			return "TESTING SINGLE LINE".equals(sf.readAsync().join())
+				&& sf.vectorReadAsync().join().equals(sf.vectorRead())
+				&& out.vectorReadAsync().join().equals(out.vectorRead())
+				&& "ASYNC".equals(out.readAsync().join());
+		}, out.f);
+	}
+	
+	public static void charsetTest() {
+		File utf16 = new File("utf16.test");
+		File utf8 = new File("utf8.test");
+		check("Explicit Charset Test", () -> {
+			Files.write(utf16.toPath(), "ONE\r\nTWO\n".getBytes(StandardCharsets.UTF_16));
+			Files.write(utf8.toPath(), "caf\u00e9\nplain\n".getBytes(StandardCharsets.UTF_8));
+			Vector<String> a = new SFileStream(utf16, StandardCharsets.UTF_16).vectorRead();
+			Vector<String> b = new SFileStream(utf8, StandardCharsets.UTF_8).vectorRead();
+			Vector<String> c = SFileStream.mapped(utf8, StandardCharsets.UTF_8).vectorRead();
+			Vector<String> d = SFileStream.mapped(utf16, StandardCharsets.UTF_16).vectorRead();
+			return (a.size() == 2) && a.elementAt(0).equals("ONE") && a.elementAt(1).equals("TWO")
+				&& (b.size() == 2) && b.elementAt(0).equals("caf\u00e9") && b.elementAt(1).equals("plain")
+				&& c.equals(b) && d.equals(a);
+		}, utf16, utf8);
+	}
+	
+	public static void byteScanTest() {
+		final byte[] prefix = "TESTING M".getBytes(StandardCharsets.US_ASCII);
+		final int[] seen = new int[3];
+		long n = new SFileStream(file).scan(line -> {
+			if(line.isAscii()) seen[0]++;
+			if(line.startsWith(prefix)) {
+				seen[1]++;
+				if(line.toString().equals("TESTING MULTIPLE LINES")) seen[2]++;
+			}
+			return true;
+		});
+		report(n == 2 && seen[0] == 2 && seen[1] == 1 && seen[2] == 1, "Byte Line Scan Test");
+	}
+	
+	public static void cancelTest() {
+		CancellationToken ct = new CancellationToken();
+		SFileStream sf = new SFileStream(file).withToken(ct);
+		boolean before = sf.vectorRead().size() == 2;
+		ct.cancel();
+		boolean cancelled = false;
+		try {
+			sf.buildIndex();
+		} catch(CancellationException ce) {
+			cancelled = true;
+		}
+		report(before && cancelled, "Cancellation Token Test");
+	}
+	
+	public static void internTest() {
+		File rep = new File("intern.test");
+		check("String Interning Test", () -> {
+			Files.write(rep.toPath(), "status=OK\nstatus=FAIL\nstatus=OK\nstatus=OK\r\n".getBytes(StandardCharsets.US_ASCII));
+			StringTable t = new StringTable();
+			Vector<String> plain = new SFileStream(rep).vectorRead();
+			Vector<String> a = new SFileStream(rep).withInterning(t).vectorRead();
+			Vector<String> b = SFileStream.mapped(rep).withInterning(t).vectorRead(2);
+			return a.equals(plain) && b.equals(plain) && (t.size() == 2)
+				&& (a.elementAt(0) == a.elementAt(2)) && (a.elementAt(0) == b.elementAt(3))
+				&& (t.intern(new String("status=FAIL")) == a.elementAt(1));
+		}, rep);
+	}
+	
+	public static void ropeTest() {
+		Rope r = Rope.EMPTY;
+		StringBuilder sb = new StringBuilder();
+		for(int i = 0; i < 2000; i++) {
+			String piece = (i % 7 == 0) ? "a much longer piece of text than the flat limit allows, number " + i : "p" + i;
+			r = r.concat(piece);
+			sb.append(piece);
+		}
+		String expect = sb.toString();
+		boolean testResult = r.length() == expect.length() && r.toString().equals(expect)
+			&& r.charAt(12345) == expect.charAt(12345)
+			&& r.subSequence(1000, 9000).toString().equals(expect.substring(1000, 9000))
+			&& r.depth() <= 48;
+		report(testResult, "Rope Concatenation Test");
+	}
+	
+	public static void metricsTest() {
+		SFileStream sf = new SFileStream(file);
+		Map<String, Long> before = Metrics.snapshot();
+		sf.singleRead();
+		sf.vectorRead();
+		Map<String, Long> after = Metrics.snapshot();
+		boolean testResult = !Metrics.ENABLED
+			|| (after.get("sfile.singleRead.ns.count") - before.get("sfile.singleRead.ns.count") == 1
+				&& after.get("sfile.vectorRead.ns.count") - before.get("sfile.vectorRead.ns.count") == 1
+				&& after.get("sfile.read.lines") - before.get("sfile.read.lines") == 3
+				&& after.get("sfile.read.bytes") - before.get("sfile.read.bytes") > new File(file).length()
+				&& Metrics.scrape().contains("sfile.vectorRead.ns.p99 "));
+		report(testResult, "IO Metrics Test");
+	}
+	
+	public static void cacheTest() {
+		File hot = new File("cache.test");
+		File dir = new File("cache.dir.test");
+		FileCache cache = new FileCache(1 << 20);
+		check("File Cache Test", () -> {
+			Files.write(hot.toPath(), "KEY=1\nKEY=2\n".getBytes(StandardCharsets.US_ASCII));
+			Vector<String> a = new SFileStream(hot).withCache(cache).vectorRead();
+			a.addElement("CALLER'S OWN");
+			Vector<String> b = new SFileStream(hot).withCache(cache).vectorRead();
+			boolean hit = (cache.size() == 1) && (b.size() == 2) && b.elementAt(0) == a.elementAt(0);
+			Files.write(hot.toPath(), "KEY=3\n".getBytes(StandardCharsets.US_ASCII));
+			Vector<String> c = new SFileStream(hot).withCache(cache).vectorRead(2);
+			boolean fresh = (c.size() == 1) && c.elementAt(0).equals("KEY=3");
+			FileCache tiny = new FileCache(10);
+			new SFileStream(hot).withCache(tiny).vectorRead();
+			// A directory cannot be read, so nothing may be cached for it.
+			dir.mkdir();
+			boolean failed = new SFileStream(dir).withCache(cache).vectorRead().isEmpty()
+				&& new SFileStream(dir).withCache(cache).vectorRead(2).isEmpty() && (cache.size() == 1);
+			return hit && fresh && failed && (tiny.size() == 0) && (cache.bytes() > 0);
+		}, hot, dir);
+	}
+	
+	public static void tailTest() {
+		File log = new File("tail.test");
+		File rotated = new File("tail.test.1");
+		check("Tail Follow Test", () -> {
+			Files.write(log.toPath(), "A\nB\npart".getBytes(StandardCharsets.US_ASCII));
+			Tail t = new SFileStream(log).tail();
+			boolean first = t.poll().equals(Arrays.asList("A", "B")) && t.offset() == 4;
+			Files.write(log.toPath(), "ial\r\nC\n".getBytes(StandardCharsets.US_ASCII), StandardOpenOption.APPEND);
+			boolean appended = t.poll().equals(Arrays.asList("partial", "C")) && t.poll().isEmpty();
+			Files.write(log.toPath(), "X\n".getBytes(StandardCharsets.US_ASCII));
+			boolean truncated = t.poll().equals(Arrays.asList("X"));
+			Files.move(log.toPath(), rotated.toPath());
+			Files.write(rotated.toPath(), "LAST".getBytes(StandardCharsets.US_ASCII), StandardOpenOption.APPEND);
+			Files.write(log.toPath(), "NEW\n".getBytes(StandardCharsets.US_ASCII));
+			boolean rotation = t.watch().await(1, TimeUnit.SECONDS).equals(Arrays.asList("LAST", "NEW"));
+			t.close();
+			return first && appended && truncated && rotation;
+		}, log, rotated);
+	}
+	
+	public static void transferTest() {
+		File src = new File("transfer.test");
+		File dst = new File("transfer.test.out");
+		check("Zero-Copy Transfer Test", () -> {
+			// Mixed terminators and bytes that are not valid UTF-8 must survive.
+			byte[] raw = { 'a', '\r', '\n', 'b', '\n', (byte)0xff, (byte)0xfe, '\r', 'c' };
+			Files.write(src.toPath(), raw);
+			Files.write(dst.toPath(), "old contents that are longer".getBytes(StandardCharsets.US_ASCII));
+			SFileStream in = new SFileStream(src);
+			SFileStream out = new SFileStream(dst);
+			boolean copied = in.transferTo(out) == raw.length && Arrays.equals(Files.readAllBytes(dst.toPath()), raw);
+			byte[] twice = new byte[raw.length * 2];
+			System.arraycopy(raw, 0, twice, 0, raw.length);
+			System.arraycopy(raw, 0, twice, raw.length, raw.length);
+			boolean appended = in.appendTo(out) == raw.length && Arrays.equals(Files.readAllBytes(dst.toPath()), twice);
+			boolean self = in.transferTo(new SFileStream(src)) == raw.length && Arrays.equals(Files.readAllBytes(src.toPath()), raw);
+			boolean missing = new SFileStream("transfer.missing.test").transferTo(out) == -1;
+			return copied && appended && self && missing;
+		}, src, dst);
+	}
+	
+	public static void nativeFileTest() {
+		File f = new File("native.test");
+		check("Native File Backend Test", () -> {
+			// Enough for several O_DIRECT blocks, with lines that straddle them.
+			Vector<String> lines = new Vector<String>(1,1);
+			Vector<String> v = new Vector<String>(1,1);
+			for(int i = 0; i < 20000; i++) {
+				lines.addElement("line " + i + " \u00e9");
+				v.addElement(lines.lastElement() + "\n");
+			}
+			SFileStream sf = new SFileStream(f, StandardCharsets.UTF_8).withDirectIO(true);
+			sf.vectorWrite(v);
+			boolean roundTrip = sf.vectorRead().equals(lines) && sf.readRange(4095, 4100).equals(new Vector<String>(lines.subList(4095, 4100)));
+			boolean direct = true;
+			if(NativeFile.ENABLED) {
+				NativeFile nf = NativeFile.open(f, NativeFile.READ | NativeFile.WRITE | NativeFile.DIRECT);
+				try {
+					byte[] raw = Files.readAllBytes(f.toPath());
+					ByteBuffer heap = ByteBuffer.allocate(10000);
+					boolean middle = nf.read(heap, 4001) == 10000 && Arrays.equals(heap.array(), Arrays.copyOfRange(raw, 4001, 14001));
+					ByteBuffer aligned = ByteBuffer.allocateDirect(8192 + 4096);
+					aligned.position(aligned.alignmentOffset(0, 4096) == 0 ? 0 : 4096 - aligned.alignmentOffset(0, 4096));
+					aligned.limit(aligned.position() + 8192);
+					int start = aligned.position();
+					boolean async = nf.readAsync(aligned, 8192).get() == 8192 && aligned.get(start) == raw[8192];
+					boolean eof = nf.read(ByteBuffer.allocate(10), raw.length) == -1;
+					nf.write(ByteBuffer.wrap("XY".getBytes(StandardCharsets.US_ASCII)), raw.length - 1);
+					boolean grown = nf.size() == raw.length + 1 && f.length() == raw.length + 1;
+					direct = middle && async && eof && grown;
+				} finally {
+					nf.close();
+				}
+			}
+			return roundTrip && direct;
+		}, f);
+	}
+	
+	public static void delimitedTest() {
+		File f = new File("delimited.test");
+		check("Delimited Columnar Read Test", () -> {
+			// A header, CRLF and LF line ends, a short row and no final newline.
+			String text = "id\tname\tscore\tnote\r\n"
+				+ "1\talpha\t2.5\tx\n"
+				+ "-42\tbeta\t-0.125\t\n"
+				+ "7\tgamma\n"
+				+ "2147483647\tdelta\t1e3\ty";
+			Files.write(f.toPath(), text.getBytes(StandardCharsets.UTF_8));
+			SFileStream sf = new SFileStream(f, StandardCharsets.UTF_8);
+			Columns c = sf.readDelimited('\t', true, 0, 2);
+			boolean shape = c.rowCount() == 4 && c.name(2).equals("score") && c.column("id") == 0;
+			boolean ints = Arrays.equals(c.ints(0), new int[] { 1, -42, 7, 2147483647 });
+			boolean strs = c.get(1, 2).equals("-0.125") && c.get(2, 2).isEmpty() && c.get(3, 2).equals("1e3");
+			boolean unread = false;
+			try {
+				c.get(0, 1);
+			} catch(IllegalArgumentException iae) {
+				unread = true;
+			}
+			boolean bad = false;
+			try {
+				c.doubles(2);
+			} catch(NumberFormatException nfe) {
+				bad = true;
+			}
+			Columns all = SFileStream.mapped(f, StandardCharsets.UTF_8).readDelimited('\t');
+			boolean mapped = all.rowCount() == 5 && all.get(0, 3).equals("note") && all.get(3, 1).equals("gamma")
+				&& all.get(4, 3).equals("y") && all.get(2, 3).isEmpty();
+			// The fast path and Double.parseDouble must agree digit for digit.
+			StringBuilder nums = new StringBuilder();
+			double[] expect = new double[2000];
+			Random rnd = new Random(3);
+			for(int i = 0; i < expect.length; i++) {
+				String d = (rnd.nextInt(2000000) - 1000000) + "." + rnd.nextInt(1000000);
+				if(i % 97 == 0) d = rnd.nextDouble() * 1e-5 + "";
+				nums.append(i).append(',').append(d).append('\n');
+				expect[i] = Double.parseDouble(d);
+			}
+			Files.write(f.toPath(), nums.toString().getBytes(StandardCharsets.US_ASCII));
+			boolean doubles = Arrays.equals(sf.readDelimited(',', 1).doubles(1), expect);
+			Files.write(f.toPath(), "5.\n.5\n-1.5E-3\nNaN\n".getBytes(StandardCharsets.US_ASCII));
+			boolean grammar = Arrays.equals(sf.readDelimited(',').doubles(0), new double[] { 5, 0.5, -1.5e-3, Double.NaN });
+			for(String t : new String[] { "1.5f", "1d", " 2", "0x1p3", ".", "1e" }) {
+				Files.write(f.toPath(), (t + "\n").getBytes(StandardCharsets.US_ASCII));
+				try {
+					sf.readDelimited(',').doubles(0);
+					grammar = false;
+				} catch(NumberFormatException nfe) {
+				}
+			}
+			return shape && ints && strs && unread && bad && mapped && doubles && grammar;
+		}, f);
+	}
+	
+	public static void grepTest() {
+		File f = new File("grep.test");
+		File gz = new File("grep.test.gz");
+		check("Pattern Search Test", () -> {
+			// Long enough for several 1 MB search buffers, with one line that
+			// is longer than a buffer and a match in the very last line.
+			StringBuilder sb = new StringBuilder();
+			Vector<String> expected = new Vector<String>(1,1);
+			ArrayList<Long> lines = new ArrayList<Long>();
+			int n = 0;
+			for(; n < 150000; n++) {
+				String s = (n % 1000 == 7) ? "row " + n + " has the needle here" : "row " + n + " is plain";
+				if(n == 70000) s = new String(new char[3 << 20]).replace('\0', 'x') + "needle";
+				if(s.contains("needle")) {
+					expected.addElement(s);
+					lines.add((long)n);
+				}
+				sb.append(s).append((n % 2 == 0) ? "\n" : "\r\n");
+			}
+			sb.append("needle at the end");
+			expected.addElement("needle at the end");
+			lines.add((long)n);
+			byte[] raw = sb.toString().getBytes(StandardCharsets.UTF_8);
+			Files.write(f.toPath(), raw);
+			SFileStream sf = new SFileStream(f, StandardCharsets.UTF_8);
+			boolean grep = sf.grep("needle").equals(expected);
+			List<LineMatch> m = sf.find("needle", true);
+			boolean numbered = m.size() == lines.size();
+			for(int i = 0; numbered && i < m.size(); i++) {
+				LineMatch lm = m.get(i);
+				numbered = lm.line() == lines.get(i) && new String(raw, (int)lm.offset(), lm.text().length(), StandardCharsets.UTF_8).equals(lm.text());
+			}
+			boolean mapped = SFileStream.mapped(f, StandardCharsets.UTF_8).grep("needle").equals(expected);
+			boolean none = sf.grep("absent").isEmpty() && sf.grep("row 12 ").size() == 1;
+			GZIPOutputStream z = new GZIPOutputStream(new FileOutputStream(gz));
+			z.write(raw);
+			z.close();
+			boolean compressed = new SFileStream(gz, StandardCharsets.UTF_8).grep("needle").equals(expected);
+			Files.write(f.toPath(), "one\ntwo needle\nthree\n".getBytes(StandardCharsets.UTF_16));
+			List<LineMatch> w = new SFileStream(f, StandardCharsets.UTF_16).find("needle", true);
+			boolean utf16 = w.size() == 1 && w.get(0).line() == 1 && w.get(0).text().equals("two needle");
+			return grep && numbered && mapped && none && compressed && utf16;
+		}, f, gz);
+	}
+	
+	public static void pipelineTest() {
+		File in = new File("pipeline.test");
+		File out = new File("pipeline.test.out");
+		check("Streaming Pipeline Test", () -> {
+			ArrayList<String> lines = new ArrayList<String>();
+			Vector<String> expected = new Vector<String>(1,1);
+			for(int i = 0; i < 100000; i++) {
+				lines.add("line " + i);
+				if(i % 3 != 0) expected.addElement("LINE " + i + "!");
+			}
+			writeLines(in, StandardCharsets.US_ASCII, lines);
+			// Small batches and rings, so every stage keeps running into
+			// full or empty neighbours.
+			long n = new SFileStream(in).pipeline()
+				.withBatch(100)
+				.withCapacity(2)
+				.filter(s -> Integer.parseInt(s.substring(5)) % 3 != 0)
+				.map(String::toUpperCase)
+				.transform(b -> {
+					for(int i = 0; i < b.size(); i++)
+						b.set(i, b.get(i) + "!");
+					return b;
+				})
+				.to(new SFileStream(out))
+				.get(60, TimeUnit.SECONDS);
+			boolean streamed = n == expected.size() && new SFileStream(out).vectorRead().equals(expected);
+			boolean failed = false;
+			try {
+				new SFileStream(in).pipeline().map(s -> {
+					if(s.equals("line 5000")) throw new IllegalStateException("boom");
+					return s;
+				}).to(new SFileStream(out)).get(60, TimeUnit.SECONDS);
+			} catch(ExecutionException ee) {
+				failed = ee.getCause() instanceof IllegalStateException;
+			}
+			CancellationToken t = new CancellationToken();
+			t.cancel();
+			boolean stopped = false;
+			try {
+				new SFileStream(in).withToken(t).pipeline().to(new SFileStream(out)).get(60, TimeUnit.SECONDS);
+			} catch(ExecutionException ee) {
+				stopped = ee.getCause() instanceof CancellationException && out.length() == 0;
+			}
+			SpscRing<Integer> ring = new SpscRing<Integer>(5);
+			boolean sized = ring.capacity() == 8 && ring.poll() == null && ring.isEmpty();
+			for(int i = 0; i < 8; i++)
+				sized = sized && ring.offer(i);
+			sized = sized && !ring.offer(8) && ring.isFull() && ring.poll() == 0;
+			return streamed && failed && stopped && sized;
+		}, in, out);
+	}
+	
+	public static void sortTest() {
+		File in = new File("sort.test");
+		File out = new File("sort.test.out");
+		check("External Sort Test", () -> {
+			// A 1 MB budget spills dozens of runs, and hundreds on a machine
+			// with many cores, which then need more than one merge pass.
+			ArrayList<String> lines = new ArrayList<String>();
+			Random rnd = new Random(11);
+			for(int i = 0; i < 300000; i++)
+				lines.add(Integer.toString(rnd.nextInt(50000)) + "\t" + i + " \u00fc");
+			writeLines(in, StandardCharsets.UTF_8, lines);
+			Comparator<String> byKey = Comparator.comparingInt(s -> Integer.parseInt(s.substring(0, s.indexOf('\t'))));
+			ArrayList<String> expected = new ArrayList<String>(lines);
+			expected.sort(byKey);
+			SFileStream src = new SFileStream(in, StandardCharsets.UTF_8);
+			SFileStream dst = new SFileStream(out, StandardCharsets.UTF_8);
+			// Stable: equal keys keep their input order.
+			boolean spilled = src.sortTo(dst, byKey, 1 << 20) == lines.size() && dst.vectorRead().equals(expected);
+			Collections.sort(expected);
+			boolean natural = src.sortTo(dst, null, 1L << 30) == lines.size() && dst.vectorRead().equals(expected);
+			// Sorting onto itself must not truncate the input first.
+			Collections.shuffle(lines, rnd);
+			writeLines(in, StandardCharsets.UTF_8, lines);
+			boolean inPlace = src.sortTo(new SFileStream(in, StandardCharsets.UTF_8), null, 1 << 20) == lines.size()
+				&& src.vectorRead().equals(expected);
+			File[] left = new File(".").listFiles((d, name) -> name.startsWith("photon-sort"));
+			boolean clean = left != null && left.length == 0;
+			return spilled && natural && inPlace && clean;
+		}, in, out);
+	}
+	
+	public static void bufferPoolTest() {
+		File out = new File("pool.test");
+		check("Buffer Pool Test", () -> {
+			ByteBuffer a = BufferPool.acquire(5000);
+			boolean sized = a.isDirect() && a.capacity() == 8192 && a.alignmentOffset(0, 4096) == 0;
+			BufferPool.release(a);
+			boolean reused = BufferPool.acquire(6000) == a;
+			ByteBuffer big = BufferPool.acquire(5 << 20);
+			boolean unpooled = big.capacity() == 5 << 20;
+			ArrayList<ByteBuffer> held = new ArrayList<ByteBuffer>();
+			for(int i = 0; i < 16; i++)
+				held.add(BufferPool.acquire(4 << 20));
+			for(ByteBuffer h : held)
+				BufferPool.release(h);
+			boolean capped = BufferPool.localBytes() <= BufferPool.LOCAL_BYTES;
+			// More output than one buffer holds, with multi-byte characters.
+			LineWriter w = new LineWriter(new FileOutputStream(out).getChannel(), StandardCharsets.UTF_8, 4096);
+			StringBuilder expected = new StringBuilder();
+			for(int i = 0; i < 5000; i++) {
+				String s = "line \u00e9\u4e2d " + i + "\n";
+				w.write(s);
+				expected.append(s);
+			}
+			w.close();
+			byte[] raw = expected.toString().getBytes(StandardCharsets.UTF_8);
+			boolean written = w.written() == raw.length && Arrays.equals(Files.readAllBytes(out.toPath()), raw);
+			return sized && reused && unpooled && capped && written;
+		}, out);
+	}
+	
+	public static void bulkReadTest() {
+		ArrayList<File> files = new ArrayList<File>();
+		for(int i = 0; i < 60; i++)
+			files.add(new File("bulk" + i + ".test"));
+		files.add(17, new File("bulk.missing.test"));
+		check("Bulk Multi-File Read Test", () -> {
+			for(int i = 0; i < 60; i++)
+				Files.write(files.get((i < 17) ? i : i + 1).toPath(), ("file " + i + "\nline two\n").getBytes(StandardCharsets.US_ASCII));
+			List<Vector<String>> all = SFileStream.readAll(files, StandardCharsets.US_ASCII, 8);
+			boolean ordered = all.size() == 61 && all.get(17).isEmpty();
+			for(int i = 0; i < 60 && ordered; i++) {
+				Vector<String> v = all.get((i < 17) ? i : i + 1);
+				ordered = v.size() == 2 && v.get(0).equals("file " + i) && v.get(1).equals("line two");
+			}
+			Map<File, Vector<String>> seen = new HashMap<File, Vector<String>>();
+			SFileStream.readAll(files, StandardCharsets.US_ASCII, 4, (f, v) -> seen.put(f, v));
+			boolean completed = seen.size() == 61 && seen.get(files.get(0)).get(0).equals("file 0");
+			boolean stopped = false;
+			Thread.currentThread().interrupt();
+			try {
+				SFileStream.readAll(files, StandardCharsets.US_ASCII, 8);
+			} catch(CancellationException ce) {
+				stopped = Thread.interrupted();
+			}
+			return ordered && completed && stopped;
+		}, files.toArray(new File[0]));
+	}
+	
+	public static void recordTest() {
+		File rec = new File("records.test");
+		File plain = new File("records.test.noindex");
+		check("Binary Record Test", () -> {
+			Vector<byte[]> records = new Vector<byte[]>();
+			for(int i = 0; i < 20000; i++)
+				records.addElement(("record-" + i).getBytes(StandardCharsets.US_ASCII));
+			records.setElementAt(new byte[0], 7);
+			// Larger than a block, so it gets one of its own.
+			records.setElementAt(new byte[200000], 11);
+			SFileStream sf = new SFileStream(rec);
+			sf.writeRecords(records);
+			boolean sequential = sameRecords(sf.readRecords(), records);
+			boolean parallel = sameRecords(sf.readRecords(4), records);
+			RecordReader rr = sf.records();
+			rr.seek(15000);
+			boolean seek = rr.hasIndex() && rr.recordCount() == 20000 && rr.blockCount() > 1
+				&& new String(rr.next(), StandardCharsets.US_ASCII).equals("record-15000");
+			rr.close();
+			RecordWriter w = new RecordWriter(plain, false, false, 256);
+			for(int i = 0; i < 1000; i++)
+				w.write(records.elementAt(i));
+			w.close();
+			rr = new RecordReader(plain);
+			rr.seek(999);
+			boolean unindexed = !rr.hasIndex() && new String(rr.next(), StandardCharsets.US_ASCII).equals("record-999")
+				&& rr.next() == null;
+			rr.close();
+			// A flipped byte inside the large record fails its block checksum.
+			byte[] raw = Files.readAllBytes(rec.toPath());
+			raw[50000] ^= 1;
+			Files.write(rec.toPath(), raw);
+			boolean corrupt = false;
+			rr = new RecordReader(rec);
+			try {
+				while(rr.next() != null);
+			} catch(IOException expected) {
+				corrupt = true;
+			}
+			rr.close();
+			return sequential && parallel && seek && unindexed && corrupt;
+		}, rec, plain);
+	}
+	
+	// vectorWrite adds no separators, so each line gets its own '\n'.
+	private static void writeLines(File f, Charset cs, List<String> lines) {
+		Vector<String> v = new Vector<String>(lines.size());
+		for(String s : lines)
+			v.addElement(s + "\n");
+		new SFileStream(f, cs).vectorWrite(v);
+	}
+	
+	private static boolean sameRecords(List<byte[]> a, List<byte[]> b) {
+		if(a.size() != b.size()) return false;
+		for(int i = 0; i < a.size(); i++)
+			if(!Arrays.equals(a.get(i), b.get(i))) return false;
+		return true;
+	}
+	
+	public static void compressedTest() {
+		File gz = new File("compressed.test.gz");
+		File bgz = new File("compressed.test.bgz");
+		check("Compressed Read Test", () -> {
+			Vector<String> expected = new Vector<String>();
+			StringBuilder text = new StringBuilder();
+			for(int i = 0; i < 3000; i++) {
+				expected.addElement("compressed line " + i);
+				text.append("compressed line ").append(i).append((i % 7 == 0) ? "\r\n" : "\n");
+			}
+			byte[] raw = text.toString().getBytes(StandardCharsets.US_ASCII);
+			GZIPOutputStream out = new GZIPOutputStream(new FileOutputStream(gz));
+			out.write(raw);
+			out.close();
+			Files.write(bgz.toPath(), bgzf(raw, 1000));
+			SFileStream g = new SFileStream(gz);
+			SFileStream b = new SFileStream(bgz);
+			boolean gzip = g.isCompressed() && g.singleRead().equals("compressed line 0")
+				&& g.vectorRead().equals(expected) && g.vectorRead(2).equals(expected)
+				&& SFileStream.mapped(gz).vectorRead().equals(expected);
+			// Small groups make most lines cross a group boundary.
+			List<String> grouped = new ArrayList<String>();
+			for(List<String> part : Compression.readBgzf(bgz, StandardCharsets.US_ASCII, null, Scheduler.pool(), CancellationToken.NONE, 2048))
+				grouped.addAll(part);
+			boolean blocks = Compression.detect(bgz) == Compression.Format.BGZF && grouped.equals(expected)
+				&& b.vectorRead().equals(expected) && b.vectorRead(2).equals(expected);
+			return gzip && blocks && !new SFileStream(file).isCompressed();
+		}, gz, bgz);
+	}
+	
+	// BGZF blocks of at most blockSize input bytes each, followed by the
+	// empty end-of-file block.
+	private static byte[] bgzf(byte[] data, int blockSize) {
+		ByteArrayOutputStream out = new ByteArrayOutputStream();
+		Deflater def = new Deflater(Deflater.DEFAULT_COMPRESSION, true);
+		byte[] buf = new byte[blockSize + 1024];
+		for(int off = 0; ; off += blockSize) {
+			int len = Math.max(0, Math.min(blockSize, data.length - off));
+			def.reset();
+			def.setInput(data, Math.min(off, data.length), len);
+			def.finish();
+			int n = 0;
+			while(!def.finished())
+				n += def.deflate(buf, n, buf.length - n);
+			CRC32 crc = new CRC32();
+			crc.update(data, Math.min(off, data.length), len);
+			int bsize = 12 + 6 + n + 8;
+			byte[] hdr = { 0x1f, (byte)0x8b, 8, 4, 0, 0, 0, 0, 0, (byte)0xff, 6, 0, 'B', 'C', 2, 0,
+				(byte)(bsize - 1), (byte)((bsize - 1) >> 8) };
+			out.write(hdr, 0, hdr.length);
+			out.write(buf, 0, n);
+			writeInt(out, (int)crc.getValue());
+			writeInt(out, len);
+			if(len == 0) break;
+		}
+		def.end();
+		return out.toByteArray();
+	}
+	
+	private static void writeInt(ByteArrayOutputStream out, int v) {
+		for(int i = 0; i < 4; i++)
+			out.write(v >> (8 * i));
+	}
+	
 }
\ No newline at end of file
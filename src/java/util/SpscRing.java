@@ -0,0 +1,110 @@
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+
+// A bounded lock-free queue for exactly one producer thread and one
+// consumer thread at a time. Each side publishes its index with a release
+// store and keeps a stale copy of the other's, so the shared cache lines
+// are only touched when the cached view runs out. The producer closes the
+// ring once it has offered its last element.
+public class SpscRing<T>
+{
+
+	// Padded on both sides so the producer's and consumer's indexes never
+	// share a cache line.
+	static class LeftPad { long p1, p2, p3, p4, p5, p6, p7; }
+
+	static class Value extends LeftPad { volatile long value; }
+
+	static class PaddedLong extends Value { long q1, q2, q3, q4, q5, q6, q7; }
+
+	private static final VarHandle VALUE;
+
+	static {
+		try {
+			VALUE = MethodHandles.lookup().findVarHandle(Value.class, "value", long.class);
+		} catch(ReflectiveOperationException e) {
+			throw new ExceptionInInitializerError(e);
+		}
+	}
+
+	private final Object[] slots;
+
+	private final int mask;
+
+	// Next index to poll, written only by the consumer.
+	private final PaddedLong head = new PaddedLong();
+
+	// Next index to offer, written only by the producer.
+	private final PaddedLong tail = new PaddedLong();
+
+	// The producer's last view of head and the consumer's of tail.
+	private long headCache;
+
+	private long tailCache;
+
+	private volatile boolean closed;
+
+	// Capacity is rounded up to a power of two.
+	@SuppressWarnings("unchecked")
+	public SpscRing(int capacity) {
+		if(capacity < 1 || capacity > (1 << 30)) throw new IllegalArgumentException("Bad ring capacity: " + capacity);
+		int n = Integer.highestOneBit(capacity);
+		if(n < capacity) n <<= 1;
+		this.slots = new Object[n];
+		this.mask = n - 1;
+	}
+
+	public int capacity() {
+		return this.slots.length;
+	}
+
+	// Producer side. False when the ring is full.
+	public boolean offer(T e) {
+		if(e == null) throw new NullPointerException();
+		long t = (long)VALUE.getOpaque(this.tail);
+		if(t - this.headCache >= this.slots.length) {
+			this.headCache = (long)VALUE.getAcquire(this.head);
+			if(t - this.headCache >= this.slots.length) return false;
+		}
+		this.slots[(int)t & this.mask] = e;
+		VALUE.setRelease(this.tail, t + 1);
+		return true;
+	}
+
+	// Consumer side. Null when the ring is empty.
+	@SuppressWarnings("unchecked")
+	public T poll() {
+		long h = (long)VALUE.getOpaque(this.head);
+		if(h >= this.tailCache) {
+			this.tailCache = (long)VALUE.getAcquire(this.tail);
+			if(h >= this.tailCache) return null;
+		}
+		int i = (int)h & this.mask;
+		T e = (T)this.slots[i];
+		this.slots[i] = null;
+		VALUE.setRelease(this.head, h + 1);
+		return e;
+	}
+
+	// Either side may ask; the answer can be stale by the time it returns,
+	// but only in the direction the other side is moving.
+	public boolean isEmpty() {
+		return (long)VALUE.getAcquire(this.head) >= (long)VALUE.getAcquire(this.tail);
+	}
+
+	public boolean isFull() {
+		return (long)VALUE.getAcquire(this.tail) - (long)VALUE.getAcquire(this.head) >= this.slots.length;
+	}
+
+	// Producer side: nothing more will be offered.
+	public void close() {
+		this.closed = true;
+	}
+
+	// Read before a poll that comes back empty, true means the ring is
+	// finished for good.
+	public boolean isClosed() {
+		return this.closed;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+import java.nio.ByteBuffer;
+
+// Concurrent intern table for strings read from files. Lookups by raw
+// bytes hash and compare the bytes against the stored strings directly,
+// so a line or field that is already in the table costs no allocation;
+// only ASCII input takes that path, anything else is decoded first.
+// Entries are plain Strings, which hold ASCII text at one byte per char,
+// and the table stops growing at maxEntries.
+public class StringTable
+{
+
+	public static final int DEFAULT_MAX_ENTRIES = 1 << 20;
+
+	private static final int SEGMENTS = 16;
+
+	private final Segment[] segments = new Segment[SEGMENTS];
+
+	public StringTable() {
+		this(DEFAULT_MAX_ENTRIES);
+	}
+
+	public StringTable(int maxEntries) {
+		for(int i = 0; i < SEGMENTS; i++)
+			this.segments[i] = new Segment(Math.max(maxEntries / SEGMENTS, 1));
+	}
+
+	public String intern(String s) {
+		int h = s.hashCode();
+		return segment(h).intern(s, h);
+	}
+
+	// The interned string for the bytes [off, off + len) of b, decoded
+	// with dec only when they are not in the table yet.
+	public String intern(ByteBuffer b, int off, int len, LineDecoder dec) {
+		if(!dec.asciiFast() || !LineDecoder.isAscii(b, off, len))
+			return intern(dec.newString(b, off, len));
+		// Same as String.hashCode() for the ASCII string these bytes decode to.
+		int h = 0;
+		for(int i = off; i < off + len; i++)
+			h = 31 * h + b.get(i);
+		Segment seg = segment(h);
+		String s = seg.find(b, off, len, h);
+		return (s != null) ? s : seg.intern(dec.newString(b, off, len), h);
+	}
+
+	public int size() {
+		int n = 0;
+		for(int i = 0; i < SEGMENTS; i++)
+			n += this.segments[i].size();
+		return n;
+	}
+
+	public void clear() {
+		for(int i = 0; i < SEGMENTS; i++)
+			this.segments[i].clear();
+	}
+
+	private static int spread(int h) {
+		return h ^ (h >>> 16);
+	}
+
+	private Segment segment(int h) {
+		return this.segments[spread(h) & (SEGMENTS - 1)];
+	}
+
+	// Open addressing over a power-of-two array. Writers lock the segment;
+	// readers never do. A slot goes from null to a String exactly once per
+	// array, and Strings are safe to publish without a lock, so a racing
+	// reader sees either the entry or a null that sends it to intern().
+	private static class Segment
+	{
+
+		private volatile String[] slots = new String[16];
+
+		private int count;
+
+		private final int max;
+
+		Segment(int max) {
+			this.max = max;
+		}
+
+		private static int slot(int h, int mask) {
+			return (spread(h) >>> 4) & mask;
+		}
+
+		String find(ByteBuffer b, int off, int len, int h) {
+			String[] t = this.slots;
+			int mask = t.length - 1;
+			for(int i = slot(h, mask); ; i = (i + 1) & mask) {
+				String s = t[i];
+				if(s == null) return null;
+				if(s.hashCode() == h && matches(s, b, off, len)) return s;
+			}
+		}
+
+		private static boolean matches(String s, ByteBuffer b, int off, int len) {
+			if(s.length() != len) return false;
+			for(int i = 0; i < len; i++)
+				if(s.charAt(i) != b.get(off + i)) return false;
+			return true;
+		}
+
+		synchronized String intern(String s, int h) {
+			String[] t = this.slots;
+			int mask = t.length - 1;
+			int i = slot(h, mask);
+			for(; t[i] != null; i = (i + 1) & mask)
+				if(t[i].hashCode() == h && t[i].equals(s)) return t[i];
+			if(this.count >= this.max) return s;
+			t[i] = s;
+			if(++this.count * 2 > t.length) grow();
+			return s;
+		}
+
+		private void grow() {
+			String[] t = this.slots;
+			String[] n = new String[t.length * 2];
+			int mask = n.length - 1;
+			for(int k = 0; k < t.length; k++) {
+				if(t[k] == null) continue;
+				int i = slot(t[k].hashCode(), mask);
+				while(n[i] != null) i = (i + 1) & mask;
+				n[i] = t[k];
+			}
+			this.slots = n;
+		}
+
+		synchronized int size() {
+			return this.count;
+		}
+
+		synchronized void clear() {
+			this.slots = new String[16];
+			this.count = 0;
+		}
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.Charset;
+import java.nio.file.ClosedWatchServiceException;
+import java.nio.file.FileSystems;
+import java.nio.file.Files;
+import java.nio.file.NoSuchFileException;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.nio.file.StandardWatchEventKinds;
+import java.nio.file.WatchKey;
+import java.nio.file.WatchService;
+import java.nio.file.attribute.BasicFileAttributes;
+import java.util.Vector;
+import java.util.concurrent.TimeUnit;
+
+// Follows a growing file. Each poll reads only the bytes appended since
+// the last complete line and returns the new complete lines; a trailing
+// partial line waits for its '\n'. A file that shrinks is read again from
+// the start, and one that is replaced (a different file key, as after log
+// rotation) has its old handle drained before the new file is opened.
+public class Tail implements Closeable
+{
+
+	public static final long DEFAULT_INTERVAL_MS = 250;
+
+	private static final int CHUNK = 1 << 20;
+
+	private File f;
+
+	private LineDecoder decoder;
+
+	private FileChannel ch;
+
+	private Object key;
+
+	private long offset;
+
+	private ByteBuffer buf = ByteBuffer.allocate(8192);
+
+	private WatchService watcher;
+
+	private CancellationToken token;
+
+	public Tail(File f, Charset cs, long offset, CancellationToken token) {
+		this.f = f;
+		this.decoder = new LineDecoder(cs);
+		this.offset = Math.max(offset, 0);
+		this.token = token;
+	}
+
+	// Bytes of the current file consumed so far, always at a line start.
+	// Passing it to a new Tail resumes where this one stopped.
+	public long offset() {
+		return this.offset;
+	}
+
+	// Waits for file system notifications instead of sleeping between
+	// polls. Falls back to polling where the platform has no watcher.
+	public Tail watch() {
+		try {
+			Path dir = this.f.getAbsoluteFile().toPath().getParent();
+			WatchService ws = FileSystems.getDefault().newWatchService();
+			dir.register(ws, StandardWatchEventKinds.ENTRY_CREATE, StandardWatchEventKinds.ENTRY_MODIFY);
+			this.watcher = ws;
+		} catch(IOException | UnsupportedOperationException e) {
+			this.watcher = null;
+		}
+		return this;
+	}
+
+	public boolean isWatching() {
+		return this.watcher != null;
+	}
+
+	public Vector<String> poll() {
+		Vector<String> v = new Vector<String>(1,1);
+		try {
+			BasicFileAttributes attrs;
+			try {
+				attrs = Files.readAttributes(this.f.toPath(), BasicFileAttributes.class);
+			} catch(NoSuchFileException nsfe) {
+				// Mid-rotation: finish the old file and wait for the new one.
+				if(this.ch != null) drain(v);
+				return v;
+			}
+			Object k = attrs.fileKey();
+			if(this.ch != null && k != null && !k.equals(this.key)) {
+				drain(v);
+				this.offset = 0;
+			}
+			if(this.ch == null) {
+				this.ch = FileChannel.open(this.f.toPath(), StandardOpenOption.READ);
+				this.key = k;
+			}
+			long size = this.ch.size();
+			if(size < this.offset) this.offset = 0;
+			readTo(size, v);
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		return v;
+	}
+
+	// Polls until there are new lines or the timeout passes, and returns
+	// whatever was read, possibly nothing.
+	public Vector<String> await(long timeout, TimeUnit unit) {
+		long deadline = System.nanoTime() + unit.toNanos(timeout);
+		while(true) {
+			this.token.throwIfCancelled();
+			Vector<String> v = poll();
+			long left = deadline - System.nanoTime();
+			if(!v.isEmpty() || left <= 0) return v;
+			long wait = Math.min(TimeUnit.NANOSECONDS.toMillis(left) + 1, DEFAULT_INTERVAL_MS);
+			try {
+				if(this.watcher != null) {
+					WatchKey wk = this.watcher.poll(wait, TimeUnit.MILLISECONDS);
+					if(wk != null) {
+						wk.pollEvents();
+						wk.reset();
+					}
+				} else {
+					Thread.sleep(wait);
+				}
+			} catch(InterruptedException ie) {
+				Thread.currentThread().interrupt();
+				return v;
+			} catch(ClosedWatchServiceException cwse) {
+				this.watcher = null;
+			}
+		}
+	}
+
+	public void close() {
+		try {
+			if(this.ch != null) this.ch.close();
+			if(this.watcher != null) this.watcher.close();
+		} catch(IOException ioe) {
+			ioe.printStackTrace();
+		}
+		this.ch = null;
+		this.watcher = null;
+	}
+
+	// Reads what is left of a rotated-away file, including a last line
+	// that will never get its '\n', then lets it go.
+	private void drain(Vector<String> v) throws IOException {
+		long end = readTo(this.ch.size(), v);
+		if(end > this.offset) {
+			ByteBuffer b = read(this.offset, (int)(end - this.offset));
+			v.addElement(this.decoder.decode(b, 0, b.limit()));
+		}
+		this.ch.close();
+		this.ch = null;
+		this.key = null;
+	}
+
+	// Consumes the complete lines in [offset, end) and returns end.
+	private long readTo(long end, Vector<String> v) throws IOException {
+		while(this.offset < end) {
+			int len = (int)Math.min(end - this.offset, CHUNK);
+			ByteBuffer b = read(this.offset, len);
+			int cut = LineScanner.lastIndexOf(b, (byte)'\n', 0, b.limit());
+			if(cut < 0) {
+				// A line longer than a chunk: keep reading until it ends.
+				if(len == CHUNK && len < end - this.offset) {
+					int eol = findEol(this.offset + len, end);
+					if(eol < 0) break;
+					b = read(this.offset, eol + 1);
+					cut = eol;
+				} else {
+					break;
+				}
+			}
+			LineScanner.split(b, 0, cut + 1, this.decoder, v);
+			this.offset += cut + 1;
+		}
+		return end;
+	}
+
+	// Index, relative to offset, of the first '\n' at or after from.
+	private int findEol(long from, long end) throws IOException {
+		for(long pos = from; pos < end; ) {
+			int len = (int)Math.min(end - pos, CHUNK);
+			ByteBuffer b = read(pos, len);
+			int i = LineScanner.indexOf(b, (byte)'\n', 0, b.limit());
+			if(i >= 0) {
+				long rel = pos + i - this.offset;
+				if(rel > Integer.MAX_VALUE - 8) throw new IOException("Line longer than 2 GB in " + this.f);
+				return (int)rel;
+			}
+			pos += len;
+		}
+		return -1;
+	}
+
+	private ByteBuffer read(long pos, int len) throws IOException {
+		if(this.buf.capacity() < len)
+			this.buf = ByteBuffer.allocate(Math.max(len, this.buf.capacity() * 2));
+		this.buf.clear();
+		this.buf.limit(len);
+		while(this.buf.hasRemaining())
+			if(this.ch.read(this.buf, pos + this.buf.position()) < 0) break;
+		this.buf.flip();
+		return this.buf;
+	}
+
+}
\ No newline at end of file
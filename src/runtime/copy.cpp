@@ -0,0 +1,145 @@
+#include "copy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+namespace photon {
+
+namespace {
+
+// Errors after which the next, more general method may still work.
+bool unsupported(int err) {
+	return err == ENOSYS || err == EXDEV || err == EINVAL || err == EOPNOTSUPP || err == ENOTSUP || err == EBADF;
+}
+
+// Each advances *done towards len and returns 0 once it is reached or
+// in hits end of file, or -errno. Progress made before an error stays in
+// *done for the next method to resume from.
+int by_copy_file_range(int in, uint64_t in_off, int out, uint64_t out_off, uint64_t len, uint64_t* done) {
+#if defined(__linux__) && defined(__NR_copy_file_range)
+	while(*done < len) {
+		loff_t ri = static_cast<loff_t>(in_off + *done);
+		loff_t wo = static_cast<loff_t>(out_off + *done);
+		long n = syscall(__NR_copy_file_range, in, &ri, out, &wo, static_cast<size_t>(len - *done), 0u);
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -errno;
+		if(n == 0) break;
+		*done += static_cast<uint64_t>(n);
+	}
+	return 0;
+#else
+	(void)in;
+	(void)in_off;
+	(void)out;
+	(void)out_off;
+	(void)len;
+	(void)done;
+	return -ENOSYS;
+#endif
+}
+
+int by_sendfile(int in, uint64_t in_off, int out, uint64_t out_off, uint64_t len, uint64_t* done) {
+#if defined(__linux__)
+	if(lseek(out, static_cast<off_t>(out_off + *done), SEEK_SET) < 0) return -errno;
+	while(*done < len) {
+		off_t ri = static_cast<off_t>(in_off + *done);
+		ssize_t n = sendfile(out, in, &ri, static_cast<size_t>(len - *done));
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -errno;
+		if(n == 0) break;
+		*done += static_cast<uint64_t>(n);
+	}
+	return 0;
+#else
+	(void)in;
+	(void)in_off;
+	(void)out;
+	(void)out_off;
+	(void)len;
+	(void)done;
+	return -ENOSYS;
+#endif
+}
+
+int by_read_write(int in, uint64_t in_off, int out, uint64_t out_off, uint64_t len, uint64_t* done) {
+	std::vector<char> buf(1 << 20);
+	while(*done < len) {
+		size_t want = static_cast<size_t>(std::min<uint64_t>(buf.size(), len - *done));
+		ssize_t n = pread(in, buf.data(), want, static_cast<off_t>(in_off + *done));
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -errno;
+		if(n == 0) break;
+		for(ssize_t w = 0; w < n; ) {
+			ssize_t k = pwrite(out, buf.data() + w, static_cast<size_t>(n - w), static_cast<off_t>(out_off + *done + w));
+			if(k < 0 && errno == EINTR) continue;
+			if(k < 0) return -errno;
+			w += k;
+		}
+		*done += static_cast<uint64_t>(n);
+	}
+	return 0;
+}
+
+}
+
+int64_t copy_range(int in, uint64_t in_off, int out, uint64_t out_off, uint64_t len) {
+	int (*methods[])(int, uint64_t, int, uint64_t, uint64_t, uint64_t*) = {by_copy_file_range, by_sendfile, by_read_write};
+	uint64_t done = 0;
+	int r = -ENOSYS;
+	for(auto method : methods) {
+		r = method(in, in_off, out, out_off, len, &done);
+		if(r == 0) return static_cast<int64_t>(done);
+		if(!unsupported(-r)) break;
+	}
+	return r;
+}
+
+int64_t copy_file(const char* src, const char* dst, bool append) {
+	int in = ::open(src, O_RDONLY | O_CLOEXEC);
+	if(in < 0) return -errno;
+	struct stat st;
+	if(fstat(in, &st) < 0) {
+		int err = errno;
+		::close(in);
+		return -err;
+	}
+	// Not O_APPEND: copy_file_range refuses descriptors opened with it.
+	// Not O_TRUNC either: dst may be src under another name, which is
+	// only known once both are open.
+	int out = ::open(dst, O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+	if(out < 0) {
+		int err = errno;
+		::close(in);
+		return -err;
+	}
+	struct stat ds;
+	int err = 0;
+	if(fstat(out, &ds) < 0)
+		err = errno;
+	else if(!append && ds.st_dev == st.st_dev && ds.st_ino == st.st_ino)
+		err = EINVAL;
+	else if(!append && ftruncate(out, 0) < 0)
+		err = errno;
+	if(err != 0) {
+		::close(in);
+		::close(out);
+		return -err;
+	}
+	uint64_t at = append ? static_cast<uint64_t>(ds.st_size) : 0;
+	int64_t r = copy_range(in, 0, out, at, static_cast<uint64_t>(st.st_size));
+	::close(in);
+	if(::close(out) < 0 && r >= 0) r = -errno;
+	return r;
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef PHOTON_COPY_H
+#define PHOTON_COPY_H
+
+#include <cstdint>
+
+namespace photon {
+
+// Copies len bytes of in at in_off to out at out_off, keeping the data in
+// the kernel where it can: copy_file_range first, which may also share
+// extents or copy server-side, then sendfile, then a pread/pwrite loop.
+// Neither descriptor's file position matters afterwards. Returns the bytes
+// copied, fewer than len only at the end of in, or -errno.
+int64_t copy_range(int in, uint64_t in_off, int out, uint64_t out_off, uint64_t len);
+
+// Copies all of src into dst, replacing dst or appending to it, and
+// creating it if needed. Returns the bytes copied or -errno; replacing a
+// file with itself, through any path, fails with -EINVAL untouched.
+int64_t copy_file(const char* src, const char* dst, bool append);
+
+}
+
+#endif
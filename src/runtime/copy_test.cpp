@@ -0,0 +1,88 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "copy.h"
+
+static int EXIT_STATUS = 0;
+
+static std::vector<std::string> endStatus;
+
+static void report(bool ok, const std::string& name) {
+	endStatus.push_back(name + (ok ? " : PASS" : " : FAIL"));
+	if(!ok) EXIT_STATUS = 1;
+}
+
+static std::string makeFile(const char* name, size_t n, char base) {
+	std::string data(n, '\0');
+	for(size_t i = 0; i < n; i++)
+		data[i] = static_cast<char>(base + i % 26);
+	FILE* f = fopen(name, "wb");
+	fwrite(data.data(), 1, data.size(), f);
+	fclose(f);
+	return data;
+}
+
+static std::string slurp(const char* name) {
+	std::string s;
+	FILE* f = fopen(name, "rb");
+	if(f == nullptr) return s;
+	char buf[65536];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		s.append(buf, n);
+	fclose(f);
+	return s;
+}
+
+static void copyTest() {
+	std::string a = makeFile("copy_a.test", 3 << 20, 'a');
+	std::string b = makeFile("copy_b.test", 1000, 'A');
+	bool ok = photon::copy_file("copy_a.test", "copy_out.test", false) == static_cast<int64_t>(a.size());
+	ok = ok && slurp("copy_out.test") == a;
+	ok = ok && photon::copy_file("copy_b.test", "copy_out.test", true) == static_cast<int64_t>(b.size());
+	ok = ok && slurp("copy_out.test") == a + b;
+	// Replacing truncates what was there.
+	ok = ok && photon::copy_file("copy_b.test", "copy_out.test", false) == static_cast<int64_t>(b.size());
+	ok = ok && slurp("copy_out.test") == b;
+	ok = ok && photon::copy_file("copy_missing.test", "copy_out.test", false) < 0;
+	// A hard link is the same file, so replacing it must not truncate src.
+	link("copy_a.test", "copy_link.test");
+	ok = ok && photon::copy_file("copy_a.test", "copy_link.test", false) == -EINVAL;
+	ok = ok && slurp("copy_a.test") == a;
+	unlink("copy_a.test");
+	unlink("copy_b.test");
+	unlink("copy_out.test");
+	unlink("copy_link.test");
+	report(ok, "File Copy Test");
+}
+
+static void rangeTest() {
+	std::string a = makeFile("copy_range.test", 100000, 'a');
+	int in = open("copy_range.test", O_RDONLY);
+	int out = open("copy_range_out.test", O_RDWR | O_CREAT | O_TRUNC, 0644);
+	bool ok = photon::copy_range(in, 500, out, 10, 2000) == 2000;
+	// Past the end of the input the copy stops short.
+	ok = ok && photon::copy_range(in, 99000, out, 2010, 5000) == 1000;
+	std::string back = slurp("copy_range_out.test");
+	ok = ok && back.size() == 3010 && back.compare(10, 2000, a, 500, 2000) == 0 && back.compare(2010, 1000, a, 99000, 1000) == 0;
+	close(in);
+	close(out);
+	unlink("copy_range.test");
+	unlink("copy_range_out.test");
+	report(ok, "Range Copy Test");
+}
+
+int main() {
+	printf("\nTesting Runtime Copy Functions ... \n\n");
+	copyTest();
+	rangeTest();
+	for(size_t i = 0; i < endStatus.size(); i++)
+		printf("%s\n", endStatus[i].c_str());
+	return EXIT_STATUS;
+}
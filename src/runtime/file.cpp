@@ -0,0 +1,176 @@
+#include "file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace photon {
+
+namespace {
+
+// Size of the bounce buffer, and so of each misaligned DIRECT transfer.
+const size_t BOUNCE = 1 << 20;
+
+uint64_t round_down(uint64_t v) {
+	return v & ~static_cast<uint64_t>(File::ALIGN - 1);
+}
+
+uint64_t round_up(uint64_t v) {
+	return round_down(v + File::ALIGN - 1);
+}
+
+bool aligned(const void* buf, size_t len, uint64_t off) {
+	return (reinterpret_cast<uintptr_t>(buf) | len | off) % File::ALIGN == 0;
+}
+
+int64_t read_all(int fd, char* buf, size_t len, uint64_t off) {
+	size_t done = 0;
+	while(done < len) {
+		ssize_t n = ::pread(fd, buf + done, len - done, static_cast<off_t>(off + done));
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -errno;
+		if(n == 0) break;
+		done += static_cast<size_t>(n);
+	}
+	return static_cast<int64_t>(done);
+}
+
+int64_t write_all(int fd, const char* buf, size_t len, uint64_t off) {
+	size_t done = 0;
+	while(done < len) {
+		ssize_t n = ::pwrite(fd, buf + done, len - done, static_cast<off_t>(off + done));
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -errno;
+		done += static_cast<size_t>(n);
+	}
+	return static_cast<int64_t>(done);
+}
+
+}
+
+File* File::open(const char* path, int flags, int* err) {
+	int mode = (flags & WRITE) ? ((flags & READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+	if(flags & CREATE) mode |= O_CREAT;
+	if(flags & TRUNCATE) mode |= O_TRUNC;
+	mode |= O_CLOEXEC;
+	bool direct = false;
+	int fd = -1;
+#ifdef O_DIRECT
+	if(flags & DIRECT) {
+		// A write that covers part of a block reads the rest of it first,
+		// so a direct writer needs the descriptor to allow reads too.
+		int dmode = (flags & WRITE) ? ((mode & ~O_ACCMODE) | O_RDWR) : mode;
+		fd = ::open(path, dmode | O_DIRECT, 0666);
+		// tmpfs and some others refuse O_DIRECT with EINVAL, and a file
+		// that may be written but not read can only be written buffered.
+		direct = fd >= 0;
+		if(fd < 0 && errno != EINVAL && !(errno == EACCES && dmode != mode)) {
+			*err = errno;
+			return nullptr;
+		}
+	}
+#endif
+	if(fd < 0) fd = ::open(path, mode, 0666);
+	if(fd < 0) {
+		*err = errno;
+		return nullptr;
+	}
+	return new File(fd, direct);
+}
+
+File::~File() {
+	::close(fd_);
+	free(bounce_);
+}
+
+char* File::bounce() {
+	if(bounce_ == nullptr) {
+		void* p = nullptr;
+		if(posix_memalign(&p, ALIGN, BOUNCE) != 0) return nullptr;
+		bounce_ = static_cast<char*>(p);
+	}
+	return bounce_;
+}
+
+int64_t File::read(void* buf, size_t len, uint64_t off) {
+	char* out = static_cast<char*>(buf);
+	if(!direct_ || aligned(buf, len, off)) return read_all(fd_, out, len, off);
+	std::lock_guard<std::mutex> g(lock_);
+	char* b = bounce();
+	if(b == nullptr) return -ENOMEM;
+	size_t done = 0;
+	while(done < len) {
+		uint64_t at = off + done;
+		uint64_t start = round_down(at);
+		size_t skip = static_cast<size_t>(at - start);
+		size_t want = std::min(len - done, BOUNCE - skip);
+		size_t span = static_cast<size_t>(round_up(skip + want));
+		int64_t n = read_all(fd_, b, span, start);
+		if(n < 0) return done ? static_cast<int64_t>(done) : n;
+		if(static_cast<size_t>(n) <= skip) break;
+		size_t got = std::min(static_cast<size_t>(n) - skip, want);
+		memcpy(out + done, b + skip, got);
+		done += got;
+		if(static_cast<size_t>(n) < span) break;
+	}
+	return static_cast<int64_t>(done);
+}
+
+// A misaligned DIRECT write rewrites whole blocks: the bytes around the
+// range in its first and last block are read back first, and the file is
+// cut back afterwards if the last block reached past its end.
+int64_t File::write(const void* buf, size_t len, uint64_t off) {
+	const char* in = static_cast<const char*>(buf);
+	if(!direct_ || aligned(buf, len, off)) return write_all(fd_, in, len, off);
+	std::lock_guard<std::mutex> g(lock_);
+	char* b = bounce();
+	if(b == nullptr) return -ENOMEM;
+	int64_t old = size();
+	if(old < 0) return old;
+	size_t done = 0;
+	while(done < len) {
+		uint64_t at = off + done;
+		uint64_t start = round_down(at);
+		size_t skip = static_cast<size_t>(at - start);
+		size_t want = std::min(len - done, BOUNCE - skip);
+		size_t span = static_cast<size_t>(round_up(skip + want));
+		if(skip != 0) {
+			memset(b, 0, ALIGN);
+			int64_t r = read_all(fd_, b, ALIGN, start);
+			if(r < 0) return r;
+		}
+		if((skip + want) % ALIGN != 0 && (span > ALIGN || skip == 0)) {
+			memset(b + span - ALIGN, 0, ALIGN);
+			int64_t r = read_all(fd_, b + span - ALIGN, ALIGN, start + span - ALIGN);
+			if(r < 0) return r;
+		}
+		memcpy(b + skip, in + done, want);
+		int64_t r = write_all(fd_, b, span, start);
+		if(r < 0) return r;
+		done += want;
+	}
+	uint64_t end = std::max(static_cast<uint64_t>(old), off + len);
+	if(end != round_up(end) && ::ftruncate(fd_, static_cast<off_t>(end)) < 0) return -errno;
+	return static_cast<int64_t>(len);
+}
+
+int64_t File::size() const {
+	struct stat st;
+	if(fstat(fd_, &st) < 0) return -errno;
+	return static_cast<int64_t>(st.st_size);
+}
+
+int File::truncate(uint64_t size) {
+	return (::ftruncate(fd_, static_cast<off_t>(size)) < 0) ? -errno : 0;
+}
+
+int File::sync() {
+	return (::fsync(fd_) < 0) ? -errno : 0;
+}
+
+}
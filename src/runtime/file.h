@@ -0,0 +1,66 @@
+#ifndef PHOTON_FILE_H
+#define PHOTON_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace photon {
+
+// A file opened for positioned reads and writes. With DIRECT it is opened
+// with O_DIRECT where the file system allows it, bypassing the page cache;
+// callers need not align anything, since misaligned transfers go through
+// an aligned bounce buffer, and a file system without O_DIRECT support
+// just gets a buffered descriptor (see direct()). DIRECT with WRITE opens
+// the file for reading as well, since partial blocks are written by
+// reading them first. Reads and writes may come from several threads,
+// but close only once they are done.
+class File {
+public:
+	enum Flags { READ = 1, WRITE = 2, CREATE = 4, TRUNCATE = 8, DIRECT = 32 };
+
+	// Returns nullptr with errno in *err when the file cannot be opened.
+	static File* open(const char* path, int flags, int* err);
+
+	~File();
+
+	File(const File&) = delete;
+	File& operator=(const File&) = delete;
+
+	int fd() const { return fd_; }
+
+	bool direct() const { return direct_; }
+
+	// Reads up to len bytes at off, retrying short reads, so it returns
+	// fewer only at end of file. Returns -errno on error.
+	int64_t read(void* buf, size_t len, uint64_t off);
+
+	// Writes all len bytes at off, or returns -errno.
+	int64_t write(const void* buf, size_t len, uint64_t off);
+
+	int64_t size() const;
+
+	int truncate(uint64_t size);
+
+	int sync();
+
+	// Alignment O_DIRECT transfers need, which covers every block size in
+	// use on Linux.
+	static const size_t ALIGN = 4096;
+
+private:
+	File(int fd, bool direct) : fd_(fd), direct_(direct) {}
+
+	char* bounce();
+
+	int fd_;
+	bool direct_;
+
+	// Guards the bounce buffer of a DIRECT file.
+	std::mutex lock_;
+	char* bounce_ = nullptr;
+};
+
+}
+
+#endif
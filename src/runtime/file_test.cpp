@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "file.h"
+
+static int EXIT_STATUS = 0;
+
+static std::vector<std::string> endStatus;
+
+static void report(bool ok, const std::string& name) {
+	endStatus.push_back(name + (ok ? " : PASS" : " : FAIL"));
+	if(!ok) EXIT_STATUS = 1;
+}
+
+// Random writes and reads at odd offsets and lengths, checked against a
+// copy of the file kept in memory.
+static void readWriteTest(int extra, const std::string& mode) {
+	int err = 0;
+	photon::File* f = photon::File::open("file_rw.test", photon::File::READ | photon::File::WRITE | photon::File::CREATE |
+		photon::File::TRUNCATE | extra, &err);
+	bool ok = f != nullptr;
+	std::string model;
+	srand(7);
+	std::vector<char> buf(3 << 20);
+	for(int i = 0; ok && i < 200; i++) {
+		size_t off = static_cast<size_t>(rand()) % (model.size() + 9000);
+		size_t len = 1 + static_cast<size_t>(rand()) % ((i % 10 == 0) ? (2 << 20) : 10000);
+		for(size_t k = 0; k < len; k++)
+			buf[k] = static_cast<char>(rand());
+		ok = f->write(buf.data(), len, off) == static_cast<int64_t>(len);
+		if(model.size() < off + len) model.resize(off + len, '\0');
+		memcpy(&model[off], buf.data(), len);
+		ok = ok && f->size() == static_cast<int64_t>(model.size());
+		size_t roff = static_cast<size_t>(rand()) % model.size();
+		size_t rlen = 1 + static_cast<size_t>(rand()) % (3 << 20);
+		int64_t n = f->read(buf.data() + 1, rlen, roff);
+		size_t expect = std::min(rlen, model.size() - roff);
+		ok = ok && n == static_cast<int64_t>(expect) && memcmp(buf.data() + 1, model.data() + roff, expect) == 0;
+	}
+	ok = ok && f->read(buf.data(), 10, model.size() + 5) == 0;
+	ok = ok && f->truncate(1000) == 0 && f->size() == 1000;
+	delete f;
+	unlink("file_rw.test");
+	report(ok, "Native File Read/Write Test (" + mode + ")");
+}
+
+// A file opened only for writing, as SFileStream's writers open it:
+// whole blocks, a tail shorter than a block and a misaligned source all
+// have to land, though O_DIRECT fills partial blocks by reading them.
+static void writeOnlyTest(int extra, const std::string& mode) {
+	int err = 0;
+	photon::File* f = photon::File::open("file_wo.test", photon::File::WRITE | photon::File::CREATE | photon::File::TRUNCATE |
+		extra, &err);
+	bool ok = f != nullptr;
+	std::vector<char> buf((64 << 10) + 4464 + 1);
+	for(size_t k = 0; k < buf.size(); k++)
+		buf[k] = static_cast<char>('a' + k % 26);
+	std::string model(buf.data() + 1, buf.size() - 1);
+	ok = ok && f->write(buf.data() + 1, 64 << 10, 0) == (64 << 10);
+	ok = ok && f->write(buf.data() + 1 + (64 << 10), 4464, 64 << 10) == 4464;
+	ok = ok && f->write("XYZ", 3, 5000) == 3;
+	model.replace(5000, 3, "XYZ");
+	ok = ok && f->size() == static_cast<int64_t>(model.size());
+	delete f;
+	std::string back;
+	FILE* in = fopen("file_wo.test", "rb");
+	if(in != nullptr) {
+		char chunk[8192];
+		size_t n;
+		while((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+			back.append(chunk, n);
+		fclose(in);
+	}
+	unlink("file_wo.test");
+	report(ok && back == model, "Native File Write-Only Test (" + mode + ")");
+}
+
+static void openTest() {
+	int err = 0;
+	photon::File* f = photon::File::open("file_missing.test", photon::File::READ, &err);
+	report(f == nullptr && err == ENOENT, "Native File Open Error Test");
+}
+
+int main() {
+	int err = 0;
+	photon::File* probe = photon::File::open("file_probe.test", photon::File::WRITE | photon::File::CREATE | photon::File::DIRECT, &err);
+	std::string direct = (probe != nullptr && probe->direct()) ? "O_DIRECT" : "buffered fallback";
+	delete probe;
+	unlink("file_probe.test");
+	printf("\nTesting Runtime File Functions ... \n\n");
+	readWriteTest(0, "buffered");
+	readWriteTest(photon::File::DIRECT, direct);
+	writeOnlyTest(0, "buffered");
+	writeOnlyTest(photon::File::DIRECT, direct);
+	openTest();
+	for(size_t i = 0; i < endStatus.size(); i++)
+		printf("%s\n", endStatus[i].c_str());
+	return EXIT_STATUS;
+}
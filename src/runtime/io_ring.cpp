@@ -0,0 +1,307 @@
+#include "io_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define PHOTON_HAVE_URING 1
+#endif
+
+namespace photon {
+
+namespace {
+
+// user_data of the NOP that wake() submits.
+const uint64_t WAKE = 0;
+
+enum : uint8_t { OP_READ = 0, OP_WRITE = 1 };
+
+int64_t transfer(int fd, uint8_t opcode, char* buf, size_t len, uint64_t off) {
+	if(opcode == OP_READ) return ::pread(fd, buf, len, static_cast<off_t>(off));
+	return ::pwrite(fd, buf, len, static_cast<off_t>(off));
+}
+
+}
+
+IoRing::IoRing(unsigned entries, bool use_uring) : entries_(entries) {
+#if PHOTON_HAVE_URING
+	if(!use_uring) return;
+	io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+	if(fd < 0) return;
+	sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if(single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+	sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(sq_ptr_ == MAP_FAILED) {
+		sq_ptr_ = nullptr;
+		::close(fd);
+		return;
+	}
+	if(single) {
+		cq_ptr_ = sq_ptr_;
+	} else {
+		cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if(cq_ptr_ == MAP_FAILED) {
+			cq_ptr_ = nullptr;
+			munmap(sq_ptr_, sq_size_);
+			sq_ptr_ = nullptr;
+			::close(fd);
+			return;
+		}
+	}
+	sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+	sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(sqes_ == MAP_FAILED) {
+		sqes_ = nullptr;
+		if(cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+		munmap(sq_ptr_, sq_size_);
+		sq_ptr_ = cq_ptr_ = nullptr;
+		::close(fd);
+		return;
+	}
+	char* sq = static_cast<char*>(sq_ptr_);
+	char* cq = static_cast<char*>(cq_ptr_);
+	sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+	sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+	sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+	sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+	cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+	cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+	cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+	cqes_ = cq + p.cq_off.cqes;
+	// Keep one submission slot free for wake().
+	entries_ = std::min(p.sq_entries, p.cq_entries) - 1;
+	ring_fd_ = fd;
+#else
+	(void)use_uring;
+#endif
+}
+
+IoRing::~IoRing() {
+	std::lock_guard<std::mutex> g(lock_);
+	for(Op* op : backlog_) {
+		if(op->close_fd) ::close(op->fd);
+		delete op;
+	}
+	if(ring_fd_ < 0) return;
+	munmap(sqes_, sqes_size_);
+	if(cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+	munmap(sq_ptr_, sq_size_);
+	::close(ring_fd_);
+}
+
+void IoRing::read(int fd, void* buf, size_t len, uint64_t off, uint64_t id, bool close_fd) {
+	submit(new Op{fd, OP_READ, close_fd, static_cast<char*>(buf), len, 0, off, id});
+}
+
+void IoRing::write(int fd, const void* buf, size_t len, uint64_t off, uint64_t id, bool close_fd) {
+	submit(new Op{fd, OP_WRITE, close_fd, static_cast<char*>(const_cast<void*>(buf)), len, 0, off, id});
+}
+
+int IoRing::read_file(const char* path, void* buf, size_t len, uint64_t id) {
+	int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return -errno;
+	read(fd, buf, len, 0, id, true);
+	return 0;
+}
+
+void IoRing::read_files(const char* const* paths, void* const* bufs, const size_t* lens, const uint64_t* ids, size_t n,
+		int* results) {
+	std::vector<Op*> ops;
+	ops.reserve(n);
+	for(size_t i = 0; i < n; i++) {
+		int fd = ::open(paths[i], O_RDONLY | O_CLOEXEC);
+		results[i] = (fd < 0) ? -errno : 0;
+		if(fd >= 0) ops.push_back(new Op{fd, OP_READ, true, static_cast<char*>(bufs[i]), lens[i], 0, 0, ids[i]});
+	}
+	submit(ops.data(), ops.size());
+}
+
+size_t IoRing::pending() const {
+	std::lock_guard<std::mutex> g(lock_);
+	return pending_;
+}
+
+void IoRing::submit(Op* op) {
+	std::unique_lock<std::mutex> g(lock_);
+	pending_++;
+	if(ring_fd_ < 0) {
+		g.unlock();
+		run_sync(op);
+		return;
+	}
+	backlog_.push_back(op);
+	pump();
+}
+
+void IoRing::submit(Op* const* ops, size_t n) {
+	std::unique_lock<std::mutex> g(lock_);
+	pending_ += n;
+	if(ring_fd_ < 0) {
+		g.unlock();
+		for(size_t i = 0; i < n; i++)
+			run_sync(ops[i]);
+		return;
+	}
+	backlog_.insert(backlog_.end(), ops, ops + n);
+	pump();
+}
+
+void IoRing::run_sync(Op* op) {
+	Completion c;
+	while(true) {
+		int64_t res = transfer(op->fd, op->opcode, op->buf + op->done, op->len - op->done, op->off + op->done);
+		if(res < 0) res = -errno;
+		if(finish(op, res, c)) break;
+	}
+	std::lock_guard<std::mutex> g(lock_);
+	done_.push_back(c);
+	ready_.notify_one();
+}
+
+// Returns true and fills c once op is complete; otherwise op has been
+// advanced past a short transfer and must be issued again.
+bool IoRing::finish(Op* op, int64_t res, Completion& c) {
+	if(res == -EINTR || res == -EAGAIN) return false;
+	if(res > 0) {
+		op->done += static_cast<size_t>(res);
+		if(op->done < op->len) return false;
+	}
+	c.id = op->id;
+	c.result = (res < 0) ? res : static_cast<int64_t>(op->done);
+	if(op->close_fd) ::close(op->fd);
+	delete op;
+	return true;
+}
+
+// Moves backlogged operations into the ring while it has room, so the
+// completion queue can never overflow. Called with lock_ held.
+void IoRing::pump() {
+#if PHOTON_HAVE_URING
+	unsigned queued = 0;
+	while(!backlog_.empty() && inflight_ < entries_) {
+		if(!push_sqe(backlog_.front())) break;
+		backlog_.pop_front();
+		inflight_++;
+		queued++;
+	}
+	if(queued) enter(queued, 0, 0);
+#endif
+}
+
+bool IoRing::push_sqe(Op* op) {
+#if PHOTON_HAVE_URING
+	unsigned tail = *sq_tail_;
+	unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+	if(tail - head > sq_mask_) return false;
+	unsigned idx = tail & sq_mask_;
+	io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + idx;
+	memset(sqe, 0, sizeof(*sqe));
+	if(op == nullptr) {
+		sqe->opcode = IORING_OP_NOP;
+		sqe->user_data = WAKE;
+	} else {
+		sqe->opcode = (op->opcode == OP_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = op->fd;
+		sqe->addr = reinterpret_cast<uint64_t>(op->buf + op->done);
+		sqe->len = static_cast<unsigned>(std::min<size_t>(op->len - op->done, 1u << 30));
+		sqe->off = op->off + op->done;
+		sqe->user_data = reinterpret_cast<uint64_t>(op);
+	}
+	sq_array_[idx] = idx;
+	__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+	return true;
+#else
+	(void)op;
+	return false;
+#endif
+}
+
+void IoRing::enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+#if PHOTON_HAVE_URING
+	while(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0) < 0 && errno == EINTR) {
+		// A signal interrupted the wait; submissions already went through.
+		to_submit = 0;
+	}
+#else
+	(void)to_submit;
+	(void)min_complete;
+	(void)flags;
+#endif
+}
+
+size_t IoRing::wait(Completion* out, size_t cap, bool block) {
+	if(ring_fd_ < 0) {
+		std::unique_lock<std::mutex> g(lock_);
+		if(block) ready_.wait(g, [this] { return !done_.empty() || woken_; });
+		woken_ = false;
+		size_t n = 0;
+		while(n < cap && !done_.empty()) {
+			out[n++] = done_.front();
+			done_.pop_front();
+		}
+		pending_ -= n;
+		return n;
+	}
+#if PHOTON_HAVE_URING
+	size_t n = 0;
+	bool woke = false;
+	while(n == 0 && !woke) {
+		unsigned head = *cq_head_;
+		unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+		if(head == tail) {
+			if(!block) break;
+			enter(0, 1, IORING_ENTER_GETEVENTS);
+			continue;
+		}
+		std::lock_guard<std::mutex> g(lock_);
+		for(; head != tail && n < cap; head++) {
+			io_uring_cqe* cqe = static_cast<io_uring_cqe*>(cqes_) + (head & cq_mask_);
+			if(cqe->user_data == WAKE) {
+				woke = true;
+				continue;
+			}
+			inflight_--;
+			Op* op = reinterpret_cast<Op*>(cqe->user_data);
+			if(finish(op, cqe->res, out[n])) {
+				n++;
+				pending_--;
+			} else {
+				backlog_.push_front(op);
+			}
+		}
+		__atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+		pump();
+	}
+	return n;
+#else
+	(void)out;
+	(void)cap;
+	(void)block;
+	return 0;
+#endif
+}
+
+void IoRing::wake() {
+	std::lock_guard<std::mutex> g(lock_);
+	if(ring_fd_ < 0) {
+		woken_ = true;
+		ready_.notify_all();
+		return;
+	}
+	// The slot held back in the constructor guarantees room for this.
+	if(push_sqe(nullptr)) enter(1, 0, 0);
+}
+
+}
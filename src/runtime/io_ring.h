@@ -0,0 +1,117 @@
+#ifndef PHOTON_IO_RING_H
+#define PHOTON_IO_RING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace photon {
+
+struct Completion {
+	uint64_t id;
+	// Bytes transferred, or -errno.
+	int64_t result;
+};
+
+// A submission/completion queue for file reads and writes. On Linux it is
+// backed by io_uring, so one waiting thread can keep many operations in
+// flight; where io_uring is missing or blocked, operations run
+// synchronously at submission and their completions are queued the same
+// way. Any thread may submit; completions are collected by one thread
+// at a time through wait(). Destroy a ring only once pending() is 0, as
+// the kernel may still be writing into buffers of in-flight operations.
+class IoRing {
+public:
+	explicit IoRing(unsigned entries = 256, bool use_uring = true);
+	~IoRing();
+
+	IoRing(const IoRing&) = delete;
+	IoRing& operator=(const IoRing&) = delete;
+
+	// True when operations really go through io_uring.
+	bool is_uring() const { return ring_fd_ >= 0; }
+
+	// Queues a read of len bytes from fd at off into buf. Short reads are
+	// continued inside the ring; the completion reports the total, which
+	// is less than len only at end of file. With close_fd set the ring
+	// owns fd and closes it once the operation completes.
+	void read(int fd, void* buf, size_t len, uint64_t off, uint64_t id, bool close_fd);
+
+	void write(int fd, const void* buf, size_t len, uint64_t off, uint64_t id, bool close_fd);
+
+	// Opens path and reads its first len bytes. Returns 0 once queued or
+	// -errno if the file cannot be opened, in which case no completion
+	// is reported.
+	int read_file(const char* path, void* buf, size_t len, uint64_t id);
+
+	// read_file for n files at once. They are queued under one lock, so
+	// io_uring takes them in as few submissions as its size allows.
+	// results[i] is what read_file would have returned for file i.
+	void read_files(const char* const* paths, void* const* bufs, const size_t* lens, const uint64_t* ids, size_t n,
+			int* results);
+
+	// Collects up to cap completions. With block set it waits for at
+	// least one unless woken by wake(), so it may return 0.
+	size_t wait(Completion* out, size_t cap, bool block);
+
+	// Makes a blocked wait() return.
+	void wake();
+
+	// Operations submitted and not yet reported.
+	size_t pending() const;
+
+private:
+	struct Op {
+		int fd;
+		uint8_t opcode;
+		bool close_fd;
+		char* buf;
+		size_t len;
+		size_t done;
+		uint64_t off;
+		uint64_t id;
+	};
+
+	void submit(Op* op);
+	void submit(Op* const* ops, size_t n);
+	void pump();
+	bool push_sqe(Op* op);
+	void enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+	bool finish(Op* op, int64_t res, Completion& c);
+	void run_sync(Op* op);
+
+	int ring_fd_ = -1;
+	unsigned entries_ = 0;
+	unsigned inflight_ = 0;
+
+	void* sq_ptr_ = nullptr;
+	void* cq_ptr_ = nullptr;
+	void* sqes_ = nullptr;
+	size_t sq_size_ = 0;
+	size_t cq_size_ = 0;
+	size_t sqes_size_ = 0;
+
+	unsigned* sq_head_ = nullptr;
+	unsigned* sq_tail_ = nullptr;
+	unsigned sq_mask_ = 0;
+	unsigned* sq_array_ = nullptr;
+	unsigned* cq_head_ = nullptr;
+	unsigned* cq_tail_ = nullptr;
+	unsigned cq_mask_ = 0;
+	void* cqes_ = nullptr;
+
+	mutable std::mutex lock_;
+	std::deque<Op*> backlog_;
+	size_t pending_ = 0;
+
+	// Synchronous fallback: finished operations waiting to be reported.
+	std::deque<Completion> done_;
+	std::condition_variable ready_;
+	bool woken_ = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io_ring.h"
+
+static int EXIT_STATUS = 0;
+
+static std::vector<std::string> endStatus;
+
+static void report(bool ok, const std::string& name) {
+	endStatus.push_back(name + (ok ? " : PASS" : " : FAIL"));
+	if(!ok) EXIT_STATUS = 1;
+}
+
+static std::string makeFile(const char* name, size_t n) {
+	std::string data(n, '\0');
+	for(size_t i = 0; i < n; i++)
+		data[i] = static_cast<char>('a' + i % 26);
+	FILE* f = fopen(name, "wb");
+	fwrite(data.data(), 1, data.size(), f);
+	fclose(f);
+	return data;
+}
+
+static void readTest(bool uring, const std::string& mode) {
+	std::string data = makeFile("ring_read.test", 100000);
+	photon::IoRing ring(8, uring);
+	const int N = 32;
+	std::vector<std::vector<char>> bufs(N, std::vector<char>(data.size() + 10));
+	bool ok = true;
+	for(int i = 0; i < N; i++)
+		ok = ok && ring.read_file("ring_read.test", bufs[i].data(), bufs[i].size(), i + 1) == 0;
+	ok = ok && ring.read_file("missing.test", bufs[0].data(), 1, 99) < 0;
+	int seen = 0;
+	photon::Completion c[4];
+	while(ok && seen < N) {
+		size_t n = ring.wait(c, 4, true);
+		for(size_t k = 0; k < n; k++) {
+			ok = ok && c[k].id >= 1 && c[k].id <= static_cast<uint64_t>(N);
+			ok = ok && c[k].result == static_cast<int64_t>(data.size());
+			ok = ok && memcmp(bufs[c[k].id - 1].data(), data.data(), data.size()) == 0;
+			seen++;
+		}
+	}
+	ok = ok && ring.pending() == 0;
+	unlink("ring_read.test");
+	report(ok, "IO Ring Read Test (" + mode + ")");
+}
+
+static void writeTest(bool uring, const std::string& mode) {
+	photon::IoRing ring(4, uring);
+	int fd = open("ring_write.test", O_CREAT | O_TRUNC | O_RDWR, 0644);
+	const char* parts[] = {"RING ", "WRITE ", "TEST"};
+	uint64_t off = 0;
+	for(int i = 0; i < 3; i++) {
+		ring.write(fd, parts[i], strlen(parts[i]), off, i + 1, false);
+		off += strlen(parts[i]);
+	}
+	photon::Completion c[3];
+	size_t seen = 0;
+	while(seen < 3)
+		seen += ring.wait(c + seen, 3 - seen, true);
+	char back[32] = {0};
+	bool ok = pread(fd, back, sizeof(back) - 1, 0) == static_cast<ssize_t>(off) && strcmp(back, "RING WRITE TEST") == 0;
+	close(fd);
+	unlink("ring_write.test");
+	report(ok, "IO Ring Write Test (" + mode + ")");
+}
+
+static void batchTest(bool uring, const std::string& mode) {
+	const int N = 40;
+	std::vector<std::string> names(N);
+	std::vector<std::string> data(N);
+	for(int i = 0; i < N; i++) {
+		names[i] = "ring_batch" + std::to_string(i) + ".test";
+		data[i] = makeFile(names[i].c_str(), 100 + 37 * i);
+	}
+	names[5] = "missing.test";
+	// Fewer entries than files, so part of the batch waits in the backlog.
+	photon::IoRing ring(8, uring);
+	std::vector<std::vector<char>> bufs(N, std::vector<char>(4000));
+	std::vector<const char*> paths(N);
+	std::vector<void*> ptrs(N);
+	std::vector<size_t> lens(N, 4000);
+	std::vector<uint64_t> ids(N);
+	for(int i = 0; i < N; i++) {
+		paths[i] = names[i].c_str();
+		ptrs[i] = bufs[i].data();
+		ids[i] = static_cast<uint64_t>(i + 1);
+	}
+	std::vector<int> results(N);
+	ring.read_files(paths.data(), ptrs.data(), lens.data(), ids.data(), N, results.data());
+	bool ok = results[5] < 0;
+	for(int i = 0; i < N; i++)
+		ok = ok && (i == 5 || results[i] == 0);
+	int seen = 0;
+	photon::Completion c[8];
+	while(ok && seen < N - 1) {
+		size_t n = ring.wait(c, 8, true);
+		for(size_t k = 0; k < n; k++) {
+			size_t i = static_cast<size_t>(c[k].id - 1);
+			ok = ok && i < N && i != 5 && c[k].result == static_cast<int64_t>(data[i].size());
+			ok = ok && memcmp(bufs[i].data(), data[i].data(), data[i].size()) == 0;
+			seen++;
+		}
+	}
+	ok = ok && ring.pending() == 0;
+	for(int i = 0; i < N; i++)
+		unlink(("ring_batch" + std::to_string(i) + ".test").c_str());
+	report(ok, "IO Ring Batch Read Test (" + mode + ")");
+}
+
+static void wakeTest(bool uring, const std::string& mode) {
+	photon::IoRing ring(4, uring);
+	ring.wake();
+	photon::Completion c;
+	report(ring.wait(&c, 1, true) == 0, "IO Ring Wake Test (" + mode + ")");
+}
+
+int main() {
+	photon::IoRing probe;
+	std::string mode = probe.is_uring() ? "io_uring" : "sync";
+	printf("\nTesting Runtime IO Ring Functions (%s) ... \n\n", mode.c_str());
+	readTest(true, mode);
+	writeTest(true, mode);
+	batchTest(true, mode);
+	wakeTest(true, mode);
+	readTest(false, "sync");
+	writeTest(false, "sync");
+	batchTest(false, "sync");
+	wakeTest(false, "sync");
+	for(size_t i = 0; i < endStatus.size(); i++)
+		printf("%s\n", endStatus[i].c_str());
+	return EXIT_STATUS;
+}
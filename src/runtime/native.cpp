@@ -0,0 +1,313 @@
+// JNI entry points for the Java Native class (src/java/util/Native.java).
+
+#include <jni.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "copy.h"
+#include "file.h"
+#include "io_ring.h"
+#include "scan.h"
+#include "zstd_stream.h"
+
+namespace {
+
+const uint8_t* direct(JNIEnv* env, jobject buf) {
+	return static_cast<const uint8_t*>(env->GetDirectBufferAddress(buf));
+}
+
+jint find(const uint8_t* p, jint from, jint to, jbyte a, jbyte b) {
+	size_t n = static_cast<size_t>(to - from);
+	size_t i = photon::find_any2(p + from, n, static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+	return (i == n) ? -1 : from + static_cast<jint>(i);
+}
+
+photon::ZstdDecoder* zstd(jlong handle) {
+	return reinterpret_cast<photon::ZstdDecoder*>(handle);
+}
+
+photon::IoRing* ring(jlong handle) {
+	return reinterpret_cast<photon::IoRing*>(handle);
+}
+
+photon::File* file(jlong handle) {
+	return reinterpret_cast<photon::File*>(handle);
+}
+
+void throwIO(JNIEnv* env, const char* what, int err) {
+	std::string msg = std::string(what) + ": " + strerror(err);
+	env->ThrowNew(env->FindClass("java/io/IOException"), msg.c_str());
+}
+
+jint scan(JNIEnv* env, const uint8_t* p, jint from, jint to, jbyte a, jbyte b, jintArray out) {
+	jsize cap = env->GetArrayLength(out);
+	jint* idx = static_cast<jint*>(env->GetPrimitiveArrayCritical(out, nullptr));
+	if(idx == nullptr) return 0;
+	size_t n = photon::scan_any2(p + from, static_cast<size_t>(to - from), static_cast<uint8_t>(a), static_cast<uint8_t>(b),
+		reinterpret_cast<uint32_t*>(idx), static_cast<size_t>(cap));
+	for(size_t k = 0; k < n; k++)
+		idx[k] += from;
+	env->ReleasePrimitiveArrayCritical(out, idx, 0);
+	return static_cast<jint>(n);
+}
+
+}
+
+extern "C" {
+
+JNIEXPORT jstring JNICALL Java_Native_nativeScanKernel(JNIEnv* env, jclass) {
+	return env->NewStringUTF(photon::scan_kernel());
+}
+
+JNIEXPORT jint JNICALL Java_Native_findDirect(JNIEnv* env, jclass, jobject buf, jint from, jint to, jbyte a, jbyte b) {
+	return find(direct(env, buf), from, to, a, b);
+}
+
+JNIEXPORT jint JNICALL Java_Native_findArray(JNIEnv* env, jclass, jbyteArray arr, jint from, jint to, jbyte a, jbyte b) {
+	void* p = env->GetPrimitiveArrayCritical(arr, nullptr);
+	if(p == nullptr) return -1;
+	jint r = find(static_cast<const uint8_t*>(p), from, to, a, b);
+	env->ReleasePrimitiveArrayCritical(arr, p, JNI_ABORT);
+	return r;
+}
+
+JNIEXPORT jint JNICALL Java_Native_scanDirect(JNIEnv* env, jclass, jobject buf, jint from, jint to, jbyte a, jbyte b, jintArray out) {
+	return scan(env, direct(env, buf), from, to, a, b, out);
+}
+
+JNIEXPORT jint JNICALL Java_Native_scanArray(JNIEnv* env, jclass, jbyteArray arr, jint from, jint to, jbyte a, jbyte b, jintArray out) {
+	// Two critical regions may be held at once as long as no other JNI
+	// call is made in between, so take the output length first.
+	jsize cap = env->GetArrayLength(out);
+	void* p = env->GetPrimitiveArrayCritical(arr, nullptr);
+	if(p == nullptr) return 0;
+	jint* idx = static_cast<jint*>(env->GetPrimitiveArrayCritical(out, nullptr));
+	if(idx == nullptr) {
+		env->ReleasePrimitiveArrayCritical(arr, p, JNI_ABORT);
+		return 0;
+	}
+	size_t n = photon::scan_any2(static_cast<const uint8_t*>(p) + from, static_cast<size_t>(to - from),
+		static_cast<uint8_t>(a), static_cast<uint8_t>(b), reinterpret_cast<uint32_t*>(idx), static_cast<size_t>(cap));
+	for(size_t k = 0; k < n; k++)
+		idx[k] += from;
+	env->ReleasePrimitiveArrayCritical(out, idx, 0);
+	env->ReleasePrimitiveArrayCritical(arr, p, JNI_ABORT);
+	return static_cast<jint>(n);
+}
+
+// Index of the first occurrence of needle in [from, to), or -1.
+JNIEXPORT jint JNICALL Java_Native_findBytesDirect(JNIEnv* env, jclass, jobject buf, jint from, jint to, jbyteArray needle) {
+	std::vector<uint8_t> s(static_cast<size_t>(env->GetArrayLength(needle)));
+	env->GetByteArrayRegion(needle, 0, static_cast<jsize>(s.size()), reinterpret_cast<jbyte*>(s.data()));
+	size_t n = static_cast<size_t>(to - from);
+	size_t i = photon::find_bytes(direct(env, buf) + from, n, s.data(), s.size());
+	return (i == n) ? -1 : from + static_cast<jint>(i);
+}
+
+JNIEXPORT jint JNICALL Java_Native_findBytesArray(JNIEnv* env, jclass, jbyteArray arr, jint from, jint to, jbyteArray needle) {
+	std::vector<uint8_t> s(static_cast<size_t>(env->GetArrayLength(needle)));
+	env->GetByteArrayRegion(needle, 0, static_cast<jsize>(s.size()), reinterpret_cast<jbyte*>(s.data()));
+	void* p = env->GetPrimitiveArrayCritical(arr, nullptr);
+	if(p == nullptr) return -1;
+	size_t n = static_cast<size_t>(to - from);
+	size_t i = photon::find_bytes(static_cast<const uint8_t*>(p) + from, n, s.data(), s.size());
+	env->ReleasePrimitiveArrayCritical(arr, p, JNI_ABORT);
+	return (i == n) ? -1 : from + static_cast<jint>(i);
+}
+
+JNIEXPORT jlong JNICALL Java_Native_ringOpen(JNIEnv*, jclass, jint entries) {
+	return reinterpret_cast<jlong>(new photon::IoRing(static_cast<unsigned>(entries)));
+}
+
+JNIEXPORT void JNICALL Java_Native_ringClose(JNIEnv*, jclass, jlong h) {
+	delete ring(h);
+}
+
+JNIEXPORT jboolean JNICALL Java_Native_ringIsUring(JNIEnv*, jclass, jlong h) {
+	return ring(h)->is_uring() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL Java_Native_ringReadFile(JNIEnv* env, jclass, jlong h, jstring path, jobject buf, jlong len, jlong id) {
+	const char* p = env->GetStringUTFChars(path, nullptr);
+	if(p == nullptr) {
+		env->ExceptionClear();
+		return -ENOMEM;
+	}
+	int r = ring(h)->read_file(p, env->GetDirectBufferAddress(buf), static_cast<size_t>(len), static_cast<uint64_t>(id));
+	env->ReleaseStringUTFChars(path, p);
+	return r;
+}
+
+// Queues reads of every file in paths into the matching direct buffers;
+// results gets 0 per queued file and -errno per file that cannot be
+// opened, which reports no completion.
+JNIEXPORT void JNICALL Java_Native_ringReadFiles(JNIEnv* env, jclass, jlong h, jobjectArray paths, jobjectArray bufs,
+		jlongArray lens, jlongArray ids, jintArray results) {
+	size_t n = static_cast<size_t>(env->GetArrayLength(paths));
+	std::vector<std::string> names(n);
+	std::vector<const char*> ps(n);
+	std::vector<void*> bs(n);
+	std::vector<jlong> ls(n);
+	std::vector<jlong> is(n);
+	env->GetLongArrayRegion(lens, 0, static_cast<jsize>(n), ls.data());
+	env->GetLongArrayRegion(ids, 0, static_cast<jsize>(n), is.data());
+	for(size_t i = 0; i < n; i++) {
+		jstring s = static_cast<jstring>(env->GetObjectArrayElement(paths, static_cast<jsize>(i)));
+		jobject b = env->GetObjectArrayElement(bufs, static_cast<jsize>(i));
+		const char* p = env->GetStringUTFChars(s, nullptr);
+		if(p == nullptr) {
+			// Nothing is queued yet, so every file fails and Java completes
+			// each future from results instead of seeing the pending error.
+			env->ExceptionClear();
+			env->DeleteLocalRef(s);
+			env->DeleteLocalRef(b);
+			std::vector<jint> out(n, -ENOMEM);
+			env->SetIntArrayRegion(results, 0, static_cast<jsize>(n), out.data());
+			return;
+		}
+		names[i] = p;
+		env->ReleaseStringUTFChars(s, p);
+		ps[i] = names[i].c_str();
+		bs[i] = env->GetDirectBufferAddress(b);
+		// Thousands of files would overflow the local reference table.
+		env->DeleteLocalRef(s);
+		env->DeleteLocalRef(b);
+	}
+	std::vector<size_t> sizes(ls.begin(), ls.end());
+	std::vector<uint64_t> keys(is.begin(), is.end());
+	std::vector<int> rs(n);
+	ring(h)->read_files(ps.data(), bs.data(), sizes.data(), keys.data(), n, rs.data());
+	std::vector<jint> out(rs.begin(), rs.end());
+	env->SetIntArrayRegion(results, 0, static_cast<jsize>(n), out.data());
+}
+
+// Blocks for completions and stores them into out as (id, result) pairs.
+JNIEXPORT jint JNICALL Java_Native_ringWait(JNIEnv* env, jclass, jlong h, jlongArray out) {
+	photon::Completion c[64];
+	size_t cap = std::min<size_t>(64, static_cast<size_t>(env->GetArrayLength(out)) / 2);
+	size_t n = ring(h)->wait(c, cap, true);
+	jlong pairs[128];
+	for(size_t i = 0; i < n; i++) {
+		pairs[2 * i] = static_cast<jlong>(c[i].id);
+		pairs[2 * i + 1] = static_cast<jlong>(c[i].result);
+	}
+	env->SetLongArrayRegion(out, 0, static_cast<jsize>(2 * n), pairs);
+	return static_cast<jint>(n);
+}
+
+JNIEXPORT void JNICALL Java_Native_ringWake(JNIEnv*, jclass, jlong h) {
+	ring(h)->wake();
+}
+
+// Copies src over dst, or onto its end, inside the kernel where the file
+// systems allow. Returns the bytes copied or -errno.
+JNIEXPORT jlong JNICALL Java_Native_copyFile(JNIEnv* env, jclass, jstring src, jstring dst, jboolean append) {
+	const char* s = env->GetStringUTFChars(src, nullptr);
+	if(s == nullptr) return -ENOMEM;
+	const char* d = env->GetStringUTFChars(dst, nullptr);
+	if(d == nullptr) {
+		env->ReleaseStringUTFChars(src, s);
+		return -ENOMEM;
+	}
+	int64_t r = photon::copy_file(s, d, append == JNI_TRUE);
+	env->ReleaseStringUTFChars(dst, d);
+	env->ReleaseStringUTFChars(src, s);
+	return static_cast<jlong>(r);
+}
+
+// Opens path with File flags; throws IOException when it cannot.
+JNIEXPORT jlong JNICALL Java_Native_fileOpen(JNIEnv* env, jclass, jstring path, jint flags) {
+	const char* p = env->GetStringUTFChars(path, nullptr);
+	if(p == nullptr) return 0;
+	int err = 0;
+	photon::File* f = photon::File::open(p, static_cast<int>(flags), &err);
+	if(f == nullptr) throwIO(env, p, err);
+	env->ReleaseStringUTFChars(path, p);
+	return reinterpret_cast<jlong>(f);
+}
+
+JNIEXPORT void JNICALL Java_Native_fileClose(JNIEnv*, jclass, jlong h) {
+	delete file(h);
+}
+
+JNIEXPORT jboolean JNICALL Java_Native_fileIsDirect(JNIEnv*, jclass, jlong h) {
+	return file(h)->direct() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Reads into [pos, pos + len) of a direct buffer; fewer than len bytes
+// means end of file.
+JNIEXPORT jint JNICALL Java_Native_fileRead(JNIEnv* env, jclass, jlong h, jobject buf, jint pos, jint len, jlong off) {
+	char* p = static_cast<char*>(env->GetDirectBufferAddress(buf));
+	int64_t r = file(h)->read(p + pos, static_cast<size_t>(len), static_cast<uint64_t>(off));
+	if(r < 0) throwIO(env, "read", static_cast<int>(-r));
+	return static_cast<jint>(r);
+}
+
+JNIEXPORT jint JNICALL Java_Native_fileWrite(JNIEnv* env, jclass, jlong h, jobject buf, jint pos, jint len, jlong off) {
+	const char* p = static_cast<const char*>(env->GetDirectBufferAddress(buf));
+	int64_t r = file(h)->write(p + pos, static_cast<size_t>(len), static_cast<uint64_t>(off));
+	if(r < 0) throwIO(env, "write", static_cast<int>(-r));
+	return static_cast<jint>(r);
+}
+
+JNIEXPORT jlong JNICALL Java_Native_fileSize(JNIEnv* env, jclass, jlong h) {
+	int64_t r = file(h)->size();
+	if(r < 0) throwIO(env, "fstat", static_cast<int>(-r));
+	return static_cast<jlong>(r);
+}
+
+JNIEXPORT void JNICALL Java_Native_fileTruncate(JNIEnv* env, jclass, jlong h, jlong size) {
+	int r = file(h)->truncate(static_cast<uint64_t>(size));
+	if(r < 0) throwIO(env, "ftruncate", -r);
+}
+
+JNIEXPORT void JNICALL Java_Native_fileSync(JNIEnv* env, jclass, jlong h) {
+	int r = file(h)->sync();
+	if(r < 0) throwIO(env, "fsync", -r);
+}
+
+// Queues a read of an open File into [pos, pos + len) of a direct buffer;
+// its completion reports id. The caller keeps the file open until then.
+JNIEXPORT void JNICALL Java_Native_ringRead(JNIEnv* env, jclass, jlong h, jlong f, jobject buf, jint pos, jint len, jlong off, jlong id) {
+	char* p = static_cast<char*>(env->GetDirectBufferAddress(buf));
+	ring(h)->read(file(f)->fd(), p + pos, static_cast<size_t>(len), static_cast<uint64_t>(off), static_cast<uint64_t>(id), false);
+}
+
+JNIEXPORT jboolean JNICALL Java_Native_zstdAvailable(JNIEnv*, jclass) {
+	return photon::ZstdDecoder::available() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL Java_Native_zstdOpen(JNIEnv*, jclass) {
+	return reinterpret_cast<jlong>(new photon::ZstdDecoder());
+}
+
+JNIEXPORT void JNICALL Java_Native_zstdClose(JNIEnv*, jclass, jlong h) {
+	delete zstd(h);
+}
+
+// Decompresses src[srcPos, srcLimit) into dst[dstPos, dstLimit) and
+// stores the bytes consumed and produced into counts. Returns 1 at the
+// end of a frame and 0 otherwise; corrupt input throws IOException.
+JNIEXPORT jint JNICALL Java_Native_zstdDecompress(JNIEnv* env, jclass, jlong h, jobject src, jint srcPos, jint srcLimit,
+		jobject dst, jint dstPos, jint dstLimit, jintArray counts) {
+	const uint8_t* in = direct(env, src);
+	uint8_t* out = static_cast<uint8_t*>(env->GetDirectBufferAddress(dst));
+	size_t used = 0;
+	size_t made = 0;
+	int r = zstd(h)->decompress(in + srcPos, static_cast<size_t>(srcLimit - srcPos), &used,
+		out + dstPos, static_cast<size_t>(dstLimit - dstPos), &made);
+	jint c[2] = {static_cast<jint>(used), static_cast<jint>(made)};
+	env->SetIntArrayRegion(counts, 0, 2, c);
+	if(r < 0) {
+		env->ThrowNew(env->FindClass("java/io/IOException"), zstd(h)->error());
+		return 0;
+	}
+	return r;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "scan.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PHOTON_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define PHOTON_SCAN_NEON 1
+#endif
+
+namespace photon {
+
+size_t find_any2_scalar(const uint8_t* p, size_t n, uint8_t a, uint8_t b) {
+	for(size_t i = 0; i < n; i++)
+		if(p[i] == a || p[i] == b) return i;
+	return n;
+}
+
+size_t scan_any2_scalar(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap) {
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++) {
+		if(p[i] == a || p[i] == b) {
+			if(count == cap) break;
+			out[count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return count;
+}
+
+size_t find_bytes_scalar(const uint8_t* p, size_t n, const uint8_t* s, size_t m) {
+	if(m == 0) return 0;
+	if(m > n) return n;
+	size_t last = n - m;
+	for(size_t i = 0; i <= last; ) {
+		const void* hit = memchr(p + i, s[0], last - i + 1);
+		if(hit == nullptr) break;
+		i = static_cast<size_t>(static_cast<const uint8_t*>(hit) - p);
+		if(memcmp(p + i + 1, s + 1, m - 1) == 0) return i;
+		i++;
+	}
+	return n;
+}
+
+namespace {
+
+// Emits one index per set bit of mask, lowest first. Returns false once
+// out is full.
+inline bool emit(uint64_t mask, size_t base, unsigned shift, uint32_t* out, size_t cap, size_t& count) {
+	while(mask) {
+		if(count == cap) return false;
+		out[count++] = static_cast<uint32_t>(base + (__builtin_ctzll(mask) >> shift));
+		mask &= mask - 1;
+	}
+	return true;
+}
+
+#if PHOTON_SCAN_X86
+
+__attribute__((target("avx2")))
+size_t find_any2_avx2(const uint8_t* p, size_t n, uint8_t a, uint8_t b) {
+	const __m256i va = _mm256_set1_epi8(static_cast<char>(a));
+	const __m256i vb = _mm256_set1_epi8(static_cast<char>(b));
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+		if(mask) return i + __builtin_ctz(mask);
+	}
+	return i + find_any2_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx2")))
+size_t scan_any2_avx2(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap) {
+	const __m256i va = _mm256_set1_epi8(static_cast<char>(a));
+	const __m256i vb = _mm256_set1_epi8(static_cast<char>(b));
+	size_t count = 0;
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+		if(!emit(mask, i, 0, out, cap, count)) return count;
+	}
+	size_t rest = scan_any2_scalar(p + i, n - i, a, b, out + count, cap - count);
+	for(size_t k = count; k < count + rest; k++)
+		out[k] += static_cast<uint32_t>(i);
+	return count + rest;
+}
+
+__attribute__((target("avx2")))
+size_t find_bytes_avx2(const uint8_t* p, size_t n, const uint8_t* s, size_t m) {
+	if(m < 2 || m > n) return find_bytes_scalar(p, n, s, m);
+	const __m256i first = _mm256_set1_epi8(static_cast<char>(s[0]));
+	const __m256i last = _mm256_set1_epi8(static_cast<char>(s[m - 1]));
+	size_t i = 0;
+	for(; i + m - 1 + 32 <= n; i += 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + m - 1));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+		while(mask) {
+			size_t k = i + __builtin_ctz(mask);
+			if(memcmp(p + k + 1, s + 1, m - 2) == 0) return k;
+			mask &= mask - 1;
+		}
+	}
+	size_t r = find_bytes_scalar(p + i, n - i, s, m);
+	return (r == n - i) ? n : i + r;
+}
+
+#endif
+
+#if PHOTON_SCAN_NEON
+
+// Narrows a byte-wise compare result to 4 bits per byte.
+inline uint64_t neon_mask(uint8x16_t hit) {
+	uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(hit), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(nib), 0);
+}
+
+size_t find_any2_neon(const uint8_t* p, size_t n, uint8_t a, uint8_t b) {
+	const uint8x16_t va = vdupq_n_u8(a);
+	const uint8x16_t vb = vdupq_n_u8(b);
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		uint8x16_t v = vld1q_u8(p + i);
+		uint64_t mask = neon_mask(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)));
+		if(mask) return i + (__builtin_ctzll(mask) >> 2);
+	}
+	return i + find_any2_scalar(p + i, n - i, a, b);
+}
+
+size_t scan_any2_neon(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap) {
+	const uint8x16_t va = vdupq_n_u8(a);
+	const uint8x16_t vb = vdupq_n_u8(b);
+	size_t count = 0;
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		uint8x16_t v = vld1q_u8(p + i);
+		// Keep one bit per byte so emit() sees each hit once.
+		uint64_t mask = neon_mask(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb))) & 0x1111111111111111ull;
+		if(!emit(mask, i, 2, out, cap, count)) return count;
+	}
+	size_t rest = scan_any2_scalar(p + i, n - i, a, b, out + count, cap - count);
+	for(size_t k = count; k < count + rest; k++)
+		out[k] += static_cast<uint32_t>(i);
+	return count + rest;
+}
+
+size_t find_bytes_neon(const uint8_t* p, size_t n, const uint8_t* s, size_t m) {
+	if(m < 2 || m > n) return find_bytes_scalar(p, n, s, m);
+	const uint8x16_t first = vdupq_n_u8(s[0]);
+	const uint8x16_t last = vdupq_n_u8(s[m - 1]);
+	size_t i = 0;
+	for(; i + m - 1 + 16 <= n; i += 16) {
+		uint8x16_t a = vld1q_u8(p + i);
+		uint8x16_t b = vld1q_u8(p + i + m - 1);
+		uint64_t mask = neon_mask(vandq_u8(vceqq_u8(a, first), vceqq_u8(b, last))) & 0x1111111111111111ull;
+		while(mask) {
+			size_t k = i + (__builtin_ctzll(mask) >> 2);
+			if(memcmp(p + k + 1, s + 1, m - 2) == 0) return k;
+			mask &= mask - 1;
+		}
+	}
+	size_t r = find_bytes_scalar(p + i, n - i, s, m);
+	return (r == n - i) ? n : i + r;
+}
+
+#endif
+
+struct Kernel {
+	size_t (*find)(const uint8_t*, size_t, uint8_t, uint8_t);
+	size_t (*scan)(const uint8_t*, size_t, uint8_t, uint8_t, uint32_t*, size_t);
+	size_t (*find_bytes)(const uint8_t*, size_t, const uint8_t*, size_t);
+	const char* name;
+};
+
+Kernel select_kernel() {
+#if PHOTON_SCAN_X86
+	if(__builtin_cpu_supports("avx2"))
+		return Kernel{find_any2_avx2, scan_any2_avx2, find_bytes_avx2, "avx2"};
+#elif PHOTON_SCAN_NEON
+	return Kernel{find_any2_neon, scan_any2_neon, find_bytes_neon, "neon"};
+#endif
+	return Kernel{find_any2_scalar, scan_any2_scalar, find_bytes_scalar, "scalar"};
+}
+
+const Kernel& kernel() {
+	static const Kernel k = select_kernel();
+	return k;
+}
+
+}
+
+size_t find_any2(const uint8_t* p, size_t n, uint8_t a, uint8_t b) {
+	return kernel().find(p, n, a, b);
+}
+
+size_t scan_any2(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap) {
+	return kernel().scan(p, n, a, b, out, cap);
+}
+
+size_t find_bytes(const uint8_t* p, size_t n, const uint8_t* s, size_t m) {
+	return kernel().find_bytes(p, n, s, m);
+}
+
+const char* scan_kernel() {
+	return kernel().name;
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef PHOTON_SCAN_H
+#define PHOTON_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace photon {
+
+// Index of the first byte in [p, p + n) equal to a or b, or n if none.
+size_t find_any2(const uint8_t* p, size_t n, uint8_t a, uint8_t b);
+
+// Writes the indexes of bytes in [p, p + n) equal to a or b into out, at
+// most cap of them, and returns how many were written. A result equal to
+// cap means the scan stopped early and should resume after out[cap - 1].
+size_t scan_any2(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap);
+
+// Index of the first occurrence of the m bytes at s in [p, p + n), or n
+// if there is none; an empty needle matches at 0. Candidates are the
+// positions where both the first and the last byte of the needle match,
+// compared a vector at a time, and only those are verified in full.
+size_t find_bytes(const uint8_t* p, size_t n, const uint8_t* s, size_t m);
+
+// Portable versions, used when no vector unit is available and as the
+// reference in tests.
+size_t find_any2_scalar(const uint8_t* p, size_t n, uint8_t a, uint8_t b);
+size_t scan_any2_scalar(const uint8_t* p, size_t n, uint8_t a, uint8_t b, uint32_t* out, size_t cap);
+size_t find_bytes_scalar(const uint8_t* p, size_t n, const uint8_t* s, size_t m);
+
+// Name of the kernel selected for this CPU: "avx2", "neon" or "scalar".
+const char* scan_kernel();
+
+}
+
+#endif
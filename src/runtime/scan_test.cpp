@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "scan.h"
+
+static int EXIT_STATUS = 0;
+
+static std::vector<const char*> endStatus;
+
+static void report(bool ok, const char* pass, const char* fail) {
+	endStatus.push_back(ok ? pass : fail);
+	if(!ok) EXIT_STATUS = 1;
+}
+
+static std::vector<uint8_t> sample(size_t n, unsigned seed) {
+	std::vector<uint8_t> v(n);
+	srand(seed);
+	for(size_t i = 0; i < n; i++) {
+		int r = rand() % 64;
+		v[i] = (r == 0) ? '\n' : (r == 1) ? '\t' : static_cast<uint8_t>('a' + r % 26);
+	}
+	return v;
+}
+
+static void findTest() {
+	bool ok = true;
+	for(size_t n = 0; n < 300 && ok; n++) {
+		std::vector<uint8_t> v = sample(n, static_cast<unsigned>(n));
+		for(size_t off = 0; off < 4 && off <= n; off++)
+			ok = ok && photon::find_any2(v.data() + off, n - off, '\n', '\t') == photon::find_any2_scalar(v.data() + off, n - off, '\n', '\t');
+	}
+	std::vector<uint8_t> none(1000, 'x');
+	ok = ok && photon::find_any2(none.data(), none.size(), '\n', '\r') == none.size();
+	report(ok, "Scan Find Test : PASS", "Scan Find Test : FAIL");
+}
+
+static void scanTest() {
+	bool ok = true;
+	for(size_t n = 0; n < 2000 && ok; n += 7) {
+		std::vector<uint8_t> v = sample(n, static_cast<unsigned>(n + 1));
+		std::vector<uint32_t> want(n + 1), got(n + 1);
+		size_t w = photon::scan_any2_scalar(v.data(), n, '\n', '\t', want.data(), want.size());
+		size_t g = photon::scan_any2(v.data(), n, '\n', '\t', got.data(), got.size());
+		ok = (w == g);
+		for(size_t i = 0; i < w && ok; i++)
+			ok = (want[i] == got[i]);
+	}
+	report(ok, "Scan Positions Test : PASS", "Scan Positions Test : FAIL");
+}
+
+static void scanCapTest() {
+	std::vector<uint8_t> v(100, '\n');
+	uint32_t out[5];
+	size_t g = photon::scan_any2(v.data(), v.size(), '\n', '\n', out, 5);
+	report(g == 5 && out[0] == 0 && out[4] == 4, "Scan Capacity Test : PASS", "Scan Capacity Test : FAIL");
+}
+
+// Needles cut from the text itself, so most of them do occur.
+static void findBytesTest() {
+	bool ok = true;
+	for(size_t n = 0; n < 400 && ok; n += 3) {
+		std::vector<uint8_t> v = sample(n, static_cast<unsigned>(n + 2));
+		for(size_t m = 0; m < 40 && ok; m += 1 + m / 4) {
+			std::vector<uint8_t> needle(m, 'q');
+			if(m <= n) {
+				size_t at = static_cast<size_t>(rand()) % (n - m + 1);
+				needle.assign(v.begin() + static_cast<long>(at), v.begin() + static_cast<long>(at + m));
+			}
+			size_t want = n;
+			for(size_t i = 0; m <= n && i + m <= n && want == n; i++)
+				if(std::equal(needle.begin(), needle.end(), v.begin() + static_cast<long>(i))) want = i;
+			ok = photon::find_bytes(v.data(), n, needle.data(), m) == want && photon::find_bytes_scalar(v.data(), n, needle.data(), m) == want;
+		}
+	}
+	std::vector<uint8_t> hay(1000, 'a');
+	const uint8_t tail[] = { 'a', 'a', 'b' };
+	ok = ok && photon::find_bytes(hay.data(), hay.size(), tail, 3) == hay.size();
+	hay[997] = 'b';
+	ok = ok && photon::find_bytes(hay.data(), hay.size(), tail, 3) == 995;
+	report(ok, "Scan Substring Test : PASS", "Scan Substring Test : FAIL");
+}
+
+int main() {
+	printf("\nTesting Runtime Scan Functions (%s) ... \n\n", photon::scan_kernel());
+	findTest();
+	scanTest();
+	scanCapTest();
+	findBytesTest();
+	for(size_t i = 0; i < endStatus.size(); i++)
+		printf("%s\n", endStatus[i]);
+	return EXIT_STATUS;
+}
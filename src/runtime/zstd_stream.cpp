@@ -0,0 +1,59 @@
+#include "zstd_stream.h"
+
+#ifdef PHOTON_ZSTD
+#include <zstd.h>
+#endif
+
+namespace photon {
+
+#ifdef PHOTON_ZSTD
+
+bool ZstdDecoder::available() {
+	return true;
+}
+
+ZstdDecoder::ZstdDecoder() : ctx_(ZSTD_createDCtx()) {
+	if(ctx_ == nullptr) error_ = "cannot allocate a zstd context";
+}
+
+ZstdDecoder::~ZstdDecoder() {
+	ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(ctx_));
+}
+
+int ZstdDecoder::decompress(const void* in, size_t in_len, size_t* consumed, void* out, size_t out_len, size_t* produced) {
+	*consumed = 0;
+	*produced = 0;
+	if(ctx_ == nullptr) return -1;
+	ZSTD_inBuffer ib = {in, in_len, 0};
+	ZSTD_outBuffer ob = {out, out_len, 0};
+	size_t r = ZSTD_decompressStream(static_cast<ZSTD_DCtx*>(ctx_), &ob, &ib);
+	*consumed = ib.pos;
+	*produced = ob.pos;
+	if(ZSTD_isError(r)) {
+		error_ = ZSTD_getErrorName(r);
+		return -1;
+	}
+	return (r == 0) ? 1 : 0;
+}
+
+#else
+
+bool ZstdDecoder::available() {
+	return false;
+}
+
+ZstdDecoder::ZstdDecoder() : error_("runtime built without libzstd") {
+}
+
+ZstdDecoder::~ZstdDecoder() {
+}
+
+int ZstdDecoder::decompress(const void*, size_t, size_t* consumed, void*, size_t, size_t* produced) {
+	*consumed = 0;
+	*produced = 0;
+	return -1;
+}
+
+#endif
+
+}
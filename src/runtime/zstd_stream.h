@@ -0,0 +1,36 @@
+#ifndef PHOTON_ZSTD_STREAM_H
+#define PHOTON_ZSTD_STREAM_H
+
+#include <cstddef>
+
+namespace photon {
+
+// Streaming zstd decompression. The runtime is built against libzstd only
+// when its header is found (see the Makefile); otherwise available() is
+// false and every decompress() call fails.
+class ZstdDecoder {
+public:
+	static bool available();
+
+	ZstdDecoder();
+	~ZstdDecoder();
+
+	ZstdDecoder(const ZstdDecoder&) = delete;
+	ZstdDecoder& operator=(const ZstdDecoder&) = delete;
+
+	// Decompresses from in into out and reports how much of each was used.
+	// Returns 1 when a frame ended, 0 when more input or output space is
+	// needed, and -1 on corrupt input, with the reason in error(). Frames
+	// may follow each other; decoding simply continues into the next one.
+	int decompress(const void* in, size_t in_len, size_t* consumed, void* out, size_t out_len, size_t* produced);
+
+	const char* error() const { return error_; }
+
+private:
+	void* ctx_ = nullptr;
+	const char* error_ = "";
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+#include "zstd_stream.h"
+
+static int EXIT_STATUS = 0;
+
+static std::vector<std::string> endStatus;
+
+static void report(bool ok, const std::string& name) {
+	endStatus.push_back(name + (ok ? " : PASS" : " : FAIL"));
+	if(!ok) EXIT_STATUS = 1;
+}
+
+static std::string compress(const std::string& s) {
+	std::string out(ZSTD_compressBound(s.size()), '\0');
+	size_t n = ZSTD_compress(&out[0], out.size(), s.data(), s.size(), 3);
+	out.resize(ZSTD_isError(n) ? 0 : n);
+	return out;
+}
+
+// Feeds input and output in small pieces so that every partial-buffer
+// path is taken, across two concatenated frames.
+static void streamTest() {
+	std::string a, b;
+	for(int i = 0; i < 5000; i++)
+		a += "line " + std::to_string(i) + "\n";
+	for(int i = 0; i < 300; i++)
+		b += "second frame " + std::to_string(i) + "\n";
+	std::string in = compress(a) + compress(b);
+	photon::ZstdDecoder dec;
+	std::string out;
+	char buf[97];
+	size_t pos = 0;
+	int frames = 0;
+	bool ok = true;
+	while(ok && (pos < in.size() || frames < 2)) {
+		size_t used, made;
+		size_t feed = std::min<size_t>(in.size() - pos, 61);
+		int r = dec.decompress(in.data() + pos, feed, &used, buf, sizeof(buf), &made);
+		ok = r >= 0 && (used > 0 || made > 0 || r == 1);
+		pos += used;
+		out.append(buf, made);
+		if(r == 1) frames++;
+		if(pos == in.size() && r == 0 && made == 0) break;
+	}
+	report(ok && frames == 2 && out == a + b, "Zstd Stream Decode Test");
+}
+
+static void corruptTest() {
+	std::string in = compress("some text that will be damaged\n");
+	// Frames carry no checksum by default, so damage the magic number.
+	in[0] ^= 0x5a;
+	photon::ZstdDecoder dec;
+	char buf[256];
+	size_t used, made;
+	int r = 0;
+	size_t pos = 0;
+	for(int i = 0; i < 10 && r == 0 && pos < in.size(); i++) {
+		r = dec.decompress(in.data() + pos, in.size() - pos, &used, buf, sizeof(buf), &made);
+		pos += used;
+	}
+	report(r < 0 && strlen(dec.error()) > 0, "Zstd Corrupt Input Test");
+}
+
+int main() {
+	printf("\nTesting Runtime Zstd Functions ... \n\n");
+	streamTest();
+	corruptTest();
+	for(size_t i = 0; i < endStatus.size(); i++)
+		printf("%s\n", endStatus[i].c_str());
+	return EXIT_STATUS;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Runs a Photon program against the classes in this directory. When
+# `make cds` has built a class-data-sharing archive next to this script,
+# the JVM maps the archived runtime classes instead of loading them.
+# JAVA picks the java binary; CLASSPATH is appended after the runtime and
+# defaults to the current directory, like plain java.
+
+dir=$(cd "$(dirname "$0")" && pwd)
+java=${JAVA:-java}
+
+if [ -f "$dir/photon.jar" ]; then
+	cp="$dir/photon.jar"
+else
+	cp="$dir"
+fi
+cp="$cp:${CLASSPATH:-.}"
+
+if [ -f "$dir/photon.jsa" ]; then
+	exec $java -XX:SharedArchiveFile="$dir/photon.jsa" -Xshare:auto -cp "$cp" "$@"
+fi
+exec $java -cp "$cp" "$@"
@@ -1 +1,18 @@
-#To be implemented in runtime
\ No newline at end of file
+# Native runtime, loaded by the Java classes when present
+RUNTIME_LIB = libphoton.so
+
+CXX = g++
+CXXFLAGS = -std=c++17 -O2 -fPIC -Wall -Wextra
+
+JNI_HOME = $(shell j=$$(command -v javac) && dirname $$(dirname $$(readlink -f $$j)))
+ifdef JAVA_HOME
+JNI_HOME = $(JAVA_HOME)
+endif
+JNI_FLAGS = -I$(JNI_HOME)/include -I$(JNI_HOME)/include/linux
+
+# Optional zstd support in the runtime, used when libzstd's header exists
+ZSTD_HOME = /usr
+ifneq ($(wildcard $(ZSTD_HOME)/include/zstd.h),)
+ZSTD_FLAGS = -DPHOTON_ZSTD -I$(ZSTD_HOME)/include
+ZSTD_LIBS = -L$(ZSTD_HOME)/lib -lzstd
+endif
\ No newline at end of file